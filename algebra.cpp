@@ -48,9 +48,9 @@ template <class T> const T& AbstractRing<T>::Divide(const Element &a, const Elem
 
 template <class T> const T& AbstractEuclideanDomain<T>::Mod(const Element &a, const Element &b) const
 {
-	Element q;
-	this->DivisionAlgorithm(result, q, a, b);
-	return result;
+	Element q, &r = this->Result();
+	this->DivisionAlgorithm(r, q, a, b);
+	return r;
 }
 
 template <class T> const T& AbstractEuclideanDomain<T>::Gcd(const Element &a, const Element &b) const
@@ -64,7 +64,7 @@ template <class T> const T& AbstractEuclideanDomain<T>::Gcd(const Element &a, co
 		unsigned int t = i0; i0 = i1; i1 = i2; i2 = t;
 	}
 
-	return result = g[i0];
+	return this->Result() = g[i0];
 }
 
 template <class T> const typename QuotientRing<T>::Element& QuotientRing<T>::MultiplicativeInverse(const Element &a) const
@@ -94,112 +94,205 @@ template <class T> T AbstractGroup<T>::ScalarMultiply(const Element &base, const
 	return result;
 }
 
-template <class T> T AbstractGroup<T>::CascadeScalarMultiply(const Element &x, const Integer &e1, const Element &y, const Integer &e2) const
+// a nonzero digit of an exponent in MultiScalarMultiply(), together with the
+// index of the multiple of its base that it adds
+struct ScalarDigit
 {
-	const unsigned expLen = STDMAX(e1.BitCount(), e2.BitCount());
-	if (expLen==0)
-		return this->Identity();
+	ScalarDigit(unsigned int position, size_t index, bool negate)
+		: position(position), index(index), negate(negate) {}
 
-	const unsigned w = (expLen <= 46 ? 1 : (expLen <= 260 ? 2 : 3));
-	const unsigned tableSize = 1<<w;
-	std::vector<Element> powerTable(tableSize << w);
+	// puts the most significant digits first
+	bool operator<(const ScalarDigit &rhs) const {return position > rhs.position;}
 
-	powerTable[1] = x;
-	powerTable[tableSize] = y;
-	if (w==1)
-		powerTable[3] = this->Add(x,y);
-	else
+	unsigned int position;
+	size_t index;
+	bool negate;
+};
+
+// returns the window size to use for an exponent of exponentBits bits, or clamps windowSize if it is not 0
+inline unsigned int ScalarWindowSize(unsigned int exponentBits, bool signedDigits, unsigned int windowSize=0)
+{
+	if (windowSize == 0)
 	{
-		powerTable[2] = this->Double(x);
-		powerTable[2*tableSize] = this->Double(y);
-
-		unsigned i, j;
-
-		for (i=3; i<tableSize; i+=2)
-			powerTable[i] = Add(powerTable[i-2], powerTable[2]);
-		for (i=1; i<tableSize; i+=2)
-			for (j=i+tableSize; j<(tableSize<<w); j+=tableSize)
-				powerTable[j] = Add(powerTable[j-tableSize], y);
-
-		for (i=3*tableSize; i<(tableSize<<w); i+=2*tableSize)
-			powerTable[i] = Add(powerTable[i-2*tableSize], powerTable[2*tableSize]);
-		for (i=tableSize; i<(tableSize<<w); i+=2*tableSize)
-			for (j=i+2; j<i+tableSize; j+=2)
-				powerTable[j] = Add(powerTable[j-1], x);
+		windowSize = exponentBits <= 17 ? 1 : (exponentBits <= 24 ? 2 : (exponentBits <= 70 ? 3 : (exponentBits <= 197 ? 4 : (exponentBits <= 539 ? 5 : (exponentBits <= 1434 ? 6 : 7)))));
+		// a width-(w+1) NAF needs as many multiples as sliding windows of w bits
+		if (signedDigits)
+			windowSize++;
 	}
+	return STDMIN(STDMAX(windowSize, signedDigits ? 2U : 1U), 16U);
+}
 
-	Element result;
-	unsigned power1 = 0, power2 = 0, prevPosition = expLen-1;
-	bool firstTime = true;
+// returns the number of odd multiples 1, 3, 5, ... of a base that the digits need
+inline size_t ScalarTableSize(unsigned int windowSize, bool signedDigits)
+{
+	return size_t(1) << (windowSize - (signedDigits ? 2 : 1));
+}
+
+// Appends the nonzero digits of exponent, which must be positive, to digits. If signedDigits,
+// these are the digits of its width-w NAF, which are odd and less than 2**(w-1) in absolute value,
+// otherwise they are sliding windows of w bits. Digit d refers to entry first + |d|/2 of the table.
+inline void AppendScalarDigits(std::vector<ScalarDigit> &digits, size_t first, Integer exponent, unsigned int windowSize, bool signedDigits)
+{
+	assert(exponent.IsPositive());
+	const word32 windowModulus = word32(1) << windowSize;
+	unsigned int position = 0;
 
-	for (int i = expLen-1; i>=0; i--)
+	while (!!exponent)
 	{
-		power1 = 2*power1 + e1.GetBit(i);
-		power2 = 2*power2 + e2.GetBit(i);
+		unsigned int zeros = 0;
+		while (!exponent.GetBit(zeros))
+			zeros++;
+		if (zeros)
+		{
+			exponent >>= zeros;
+			position += zeros;
+		}
 
-		if (i==0 || 2*power1 >= tableSize || 2*power2 >= tableSize)
+		word32 window = word32(exponent.GetBits(0, windowSize));
+		bool negate = signedDigits && window > windowModulus/2;
+		if (negate)
 		{
-			unsigned squaresBefore = prevPosition-i;
-			unsigned squaresAfter = 0;
-			prevPosition = i;
-			while ((power1 || power2) && power1%2 == 0 && power2%2==0)
-			{
-				power1 /= 2;
-				power2 /= 2;
-				squaresBefore--;
-				squaresAfter++;
-			}
-			if (firstTime)
+			window = windowModulus - window;
+			exponent += window;
+		}
+		else
+			exponent -= window;
+
+		digits.push_back(ScalarDigit(position, first + window/2, negate));
+		exponent >>= windowSize;
+		position += windowSize;
+	}
+}
+
+template <class T> T AbstractGroup<T>::CascadeScalarMultiply(const Element &x, const Integer &e1, const Element &y, const Integer &e2) const
+{
+	const Element bases[2] = {x, y};
+	const Integer exponents[2] = {e1, e2};
+	return this->MultiScalarMultiply(bases, exponents, 2);
+}
+
+template <class T> T AbstractGroup<T>::MultiScalarMultiply(const Element *bases, const Integer *exponents, unsigned int count, const unsigned int *windowSizes) const
+{
+	const bool signedDigits = InversionIsFast();
+	std::vector<Element> table;
+	std::vector<ScalarDigit> digits;
+
+	for (unsigned int i=0; i<count; i++)
+	{
+		if (exponents[i].IsZero())
+			continue;
+
+		Element base = bases[i];
+		Integer exponent = exponents[i];
+		if (exponent.IsNegative())
+		{
+			exponent.Negate();
+			base = this->Inverse(base);
+		}
+
+		unsigned int windowSize = ScalarWindowSize(exponent.BitCount(), signedDigits, windowSizes ? windowSizes[i] : 0);
+		size_t first = table.size(), tableSize = ScalarTableSize(windowSize, signedDigits);
+		table.reserve(first + tableSize);
+		table.push_back(base);
+		if (tableSize > 1)
+		{
+			Element twice = this->Double(base);
+			for (size_t j=1; j<tableSize; j++)
+				table.push_back(this->Add(table[first+j-1], twice));
+		}
+
+		AppendScalarDigits(digits, first, exponent, windowSize, signedDigits);
+	}
+
+	if (digits.empty())
+		return this->Identity();
+
+	std::sort(digits.begin(), digits.end());
+
+	std::vector<ScalarDigit>::const_iterator digit = digits.begin();
+	Element result = digit->negate ? this->Inverse(table[digit->index]) : table[digit->index];
+	for (unsigned int position = (digit++)->position; ; position--)
+	{
+		for (; digit != digits.end() && digit->position == position; ++digit)
+		{
+			if (digit->negate)
 			{
-				result = powerTable[(power2<<w) + power1];
-				firstTime = false;
+				// not Reduce(), since Subtract() may return a reference to its own copy of result
+				Element negated = this->Inverse(table[digit->index]);
+				this->Accumulate(result, negated);
 			}
 			else
-			{
-				while (squaresBefore--)
-					result = this->Double(result);
-				if (power1 || power2)
-					Accumulate(result, powerTable[(power2<<w) + power1]);
-			}
-			while (squaresAfter--)
-				result = this->Double(result);
-			power1 = power2 = 0;
+				this->Accumulate(result, table[digit->index]);
 		}
+		if (position == 0)
+			break;
+		result = this->Double(result);
 	}
 	return result;
 }
 
+template <class Iterator>
+struct CompareExponents
+{
+	bool operator()(const Iterator &a, const Iterator &b) const {return a->exponent < b->exponent;}
+};
+
 template <class Element, class Iterator> Element GeneralCascadeMultiplication(const AbstractGroup<Element> &group, Iterator begin, Iterator end)
 {
-	if (end-begin == 1)
+	if (begin == end)
+		return group.Identity();
+	else if (end-begin == 1)
 		return group.ScalarMultiply(begin->base, begin->exponent);
 	else if (end-begin == 2)
 		return group.CascadeScalarMultiply(begin->base, begin->exponent, (begin+1)->base, (begin+1)->exponent);
+	else if (group.InversionIsFast())
+	{
+		// signed digits keep the interleaved additions few even for the short
+		// exponents of fixed base precomputations
+		std::vector<Element> bases;
+		std::vector<Integer> exponents;
+		bases.reserve(end-begin);
+		exponents.reserve(end-begin);
+		for (Iterator it=begin; it!=end; ++it)
+		{
+			bases.push_back(it->base);
+			exponents.push_back(it->exponent);
+		}
+
+		return group.MultiScalarMultiply(&bases[0], &exponents[0], (unsigned int)bases.size());
+	}
 	else
 	{
+		// keep a heap of iterators instead of the bases and exponents themselves,
+		// so that reordering it doesn't copy group elements
+		std::vector<Iterator> heap;
+		heap.reserve(end-begin);
+		for (Iterator it=begin; it!=end; ++it)
+			heap.push_back(it);
+
+		CompareExponents<Iterator> compare;
 		Integer q, t;
-		Iterator last = end;
-		--last;
 
-		std::make_heap(begin, end);
-		std::pop_heap(begin, end);
+		std::make_heap(heap.begin(), heap.end(), compare);
+		std::pop_heap(heap.begin(), heap.end(), compare);
 
-		while (!!begin->exponent)
+		while (!!heap.front()->exponent)
 		{
-			// last->exponent is largest exponent, begin->exponent is next largest
+			// heap.back() has the largest exponent, heap.front() the next largest
+			Iterator last = heap.back(), next = heap.front();
 			t = last->exponent;
-			Integer::Divide(last->exponent, q, t, begin->exponent);
+			Integer::Divide(last->exponent, q, t, next->exponent);
 
 			if (q == Integer::One())
-				group.Accumulate(begin->base, last->base);	// avoid overhead of ScalarMultiply()
+				group.Accumulate(next->base, last->base);	// avoid overhead of ScalarMultiply()
 			else
-				group.Accumulate(begin->base, group.ScalarMultiply(last->base, q));
+				group.Accumulate(next->base, group.ScalarMultiply(last->base, q));
 
-			std::push_heap(begin, end);
-			std::pop_heap(begin, end);
+			std::push_heap(heap.begin(), heap.end(), compare);
+			std::pop_heap(heap.begin(), heap.end(), compare);
 		}
 
-		return group.ScalarMultiply(last->base, last->exponent);
+		return group.ScalarMultiply(heap.back()->base, heap.back()->exponent);
 	}
 }
 
@@ -251,10 +344,24 @@ struct WindowSlider
 	bool fastNegate, negateNext, firstTime, finished;
 };
 
+// a += b, where a and b stand for the identity unless aSet and bSet, which saves
+// the additions of the identity that are not free in every group
+template <class T> inline void AccumulateSparse(const AbstractGroup<T> &group, T &a, bool &aSet, const T &b, bool bSet)
+{
+	if (!bSet)
+		return;
+	if (aSet)
+		group.Accumulate(a, b);
+	else
+		a = b;
+	aSet = true;
+}
+
 template <class T>
 void AbstractGroup<T>::SimultaneousMultiply(T *results, const T &base, const Integer *expBegin, unsigned int expCount) const
 {
 	std::vector<std::vector<Element> > buckets(expCount);
+	std::vector<std::vector<bool> > bucketsSet(expCount);
 	std::vector<WindowSlider> exponents;
 	exponents.reserve(expCount);
 	unsigned int i;
@@ -264,7 +371,8 @@ void AbstractGroup<T>::SimultaneousMultiply(T *results, const T &base, const Int
 		assert(expBegin->NotNegative());
 		exponents.push_back(WindowSlider(*expBegin++, InversionIsFast(), 0));
 		exponents[i].FindNextWindow();
-		buckets[i].resize(1<<(exponents[i].windowSize-1), Identity());
+		buckets[i].resize(1<<(exponents[i].windowSize-1));
+		bucketsSet[i].resize(buckets[i].size(), false);
 	}
 
 	unsigned int expBitPosition = 0;
@@ -278,11 +386,10 @@ void AbstractGroup<T>::SimultaneousMultiply(T *results, const T &base, const Int
 		{
 			if (!exponents[i].finished && expBitPosition == exponents[i].windowBegin)
 			{
-				Element &bucket = buckets[i][exponents[i].expWindow/2];
-				if (exponents[i].negateNext)
-					Accumulate(bucket, Inverse(g));
-				else
-					Accumulate(bucket, g);
+				const size_t j = exponents[i].expWindow/2;
+				bool set = bucketsSet[i][j];
+				AccumulateSparse(*this, buckets[i][j], set, exponents[i].negateNext ? Element(Inverse(g)) : g, true);
+				bucketsSet[i][j] = set;
 				exponents[i].FindNextWindow();
 			}
 			notDone = notDone || !exponents[i].finished;
@@ -297,21 +404,76 @@ void AbstractGroup<T>::SimultaneousMultiply(T *results, const T &base, const Int
 
 	for (i=0; i<expCount; i++)
 	{
+		std::vector<Element> &bucket = buckets[i];
+		std::vector<bool> &bucketSet = bucketsSet[i];
+		const size_t last = bucket.size()-1;
 		Element &r = *results++;
-		r = buckets[i][buckets[i].size()-1];
-		if (buckets[i].size() > 1)
+		bool rSet = false;
+
+		// r = sum of (2j+1)*bucket[j]
+		AccumulateSparse(*this, r, rSet, bucket[last], bucketSet[last]);
+		if (last > 0)
 		{
-			for (int j = (int)buckets[i].size()-2; j >= 1; j--)
+			for (size_t j=last-1; j>=1; j--)
 			{
-				Accumulate(buckets[i][j], buckets[i][j+1]);
-				Accumulate(r, buckets[i][j]);
+				bool set = bucketSet[j];
+				AccumulateSparse(*this, bucket[j], set, bucket[j+1], bucketSet[j+1]);
+				bucketSet[j] = set;
+				AccumulateSparse(*this, r, rSet, bucket[j], set);
 			}
-			Accumulate(buckets[i][0], buckets[i][1]);
-			r = Add(Double(r), buckets[i][0]);
+			bool set = bucketSet[0];
+			AccumulateSparse(*this, bucket[0], set, bucket[1], bucketSet[1]);
+			if (rSet)
+				r = Double(r);
+			AccumulateSparse(*this, r, rSet, bucket[0], set);
 		}
+		if (!rSet)
+			r = Identity();
 	}
 }
 
+template <class Element, class Iterator> void ParallelInvert(const AbstractRing<Element> &ring, Iterator begin, Iterator end)
+{
+	size_t n = end-begin;
+	if (n == 1)
+		*begin = ring.MultiplicativeInverse(*begin);
+	else if (n > 1)
+	{
+		std::vector<Element> vec((n+1)/2);
+		unsigned int i;
+		Iterator it;
+
+		for (i=0, it=begin; i<n/2; i++, it+=2)
+			vec[i] = ring.Multiply(*it, *(it+1));
+		if (n%2 == 1)
+			vec[n/2] = *it;
+
+		ParallelInvert(ring, vec.begin(), vec.end());
+
+		for (i=0, it=begin; i<n/2; i++, it+=2)
+		{
+			if (ring.Equal(vec[i], ring.Identity()))
+			{
+				*it = ring.MultiplicativeInverse(*it);
+				*(it+1) = ring.MultiplicativeInverse(*(it+1));
+			}
+			else
+			{
+				std::swap(*it, *(it+1));
+				*it = ring.Multiply(*it, vec[i]);
+				*(it+1) = ring.Multiply(*(it+1), vec[i]);
+			}
+		}
+		if (n%2 == 1)
+			*it = vec[n/2];
+	}
+}
+
+template <class T> void AbstractRing<T>::SimultaneousInverse(T *elements, unsigned int count) const
+{
+	ParallelInvert(*this, elements, elements+count);
+}
+
 template <class T> T AbstractRing<T>::Exponentiate(const Element &base, const Integer &exponent) const
 {
 	Element result;
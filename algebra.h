@@ -2,11 +2,98 @@
 #define CRYPTOPP_ALGEBRA_H
 
 #include "config.h"
+#include <map>
 
 NAMESPACE_BEGIN(CryptoPP)
 
 class Integer;
 
+//! per-thread scratch space for the results of algebraic operations
+/*! Group, ring and field objects return references to mutable result members (see below),
+	so normally an object can only be used by one thread at a time. While an ArithmeticWorkspace
+	exists on a thread, those members are replaced on that thread by private copies owned by
+	the workspace, so one object, together with any precomputation built on it, can be shared
+	by all threads that have a workspace.
+	Workspaces nest, and only the outermost one on a thread takes effect. Its copies are
+	wiped and freed when it is destroyed. A copy is made for an Owner, so a workspace never
+	gives an object the copies that it made for another object that lived at the same address. */
+class CRYPTOPP_DLL ArithmeticWorkspace
+{
+public:
+	//! identifies the object whose members a workspace copies
+	/*! Every object gets a new identity, and so does an object that is copied into or renewed. */
+	class CRYPTOPP_DLL Owner
+	{
+	public:
+		Owner() : m_id(NewId()) {}
+		Owner(const Owner &) : m_id(NewId()) {}
+		Owner & operator=(const Owner &) {m_id = NewId(); return *this;}
+
+		//! gives the owner a new identity, for instance after its members changed size
+		void Renew() {m_id = NewId();}
+		lword GetId() const {return m_id;}
+
+	private:
+		static lword NewId();
+
+		lword m_id;
+	};
+
+	ArithmeticWorkspace();
+	~ArithmeticWorkspace();
+
+	//! returns the calling thread's copy of member, or member itself if the thread has no workspace
+	template <class T> static T & Scratch(const Owner &owner, T &member)
+	{
+		ArithmeticWorkspace *workspace = Current();
+		return workspace ? static_cast<Slot<T> *>(workspace->Find(owner.GetId(), &member, &Slot<T>::New))->value : member;
+	}
+
+	//! discards the calling thread's copy of member, called when its owner is destroyed
+	template <class T> static void Release(T &member)
+	{
+		ArithmeticWorkspace *workspace = Current();
+		if (workspace)
+			workspace->Remove(&member);
+	}
+
+	//! returns whether the calling thread has a workspace
+	static bool IsActive() {return Current() != 0;}
+
+private:
+	ArithmeticWorkspace(const ArithmeticWorkspace &);
+	void operator=(const ArithmeticWorkspace &);
+
+	struct SlotBase
+	{
+		virtual ~SlotBase() {}
+	};
+
+	template <class T> struct Slot : public SlotBase
+	{
+		Slot(const T &member) : value(member) {}
+		static SlotBase * New(const void *member) {return new Slot<T>(*static_cast<const T *>(member));}
+		T value;
+	};
+
+	typedef SlotBase * (*SlotFactory)(const void *member);
+
+	struct Entry
+	{
+		lword owner;
+		SlotFactory factory;
+		SlotBase *slot;
+	};
+	typedef std::map<const void *, Entry> EntryMap;
+
+	static ArithmeticWorkspace * Current();
+	SlotBase * Find(lword owner, const void *member, SlotFactory factory);
+	void Remove(const void *member);
+
+	EntryMap m_entries;
+	bool m_installed;
+};
+
 // "const Element&" returned by member functions are references
 // to internal data members. Since each object may have only
 // one such data member for holding results, the following code
@@ -37,6 +124,13 @@ public:
 	virtual Element ScalarMultiply(const Element &a, const Integer &e) const;
 	virtual Element CascadeScalarMultiply(const Element &x, const Integer &e1, const Element &y, const Integer &e2) const;
 
+	//! returns the sum of exponents[i]*bases[i] for i < count
+	/*! The exponents are recoded into width-w NAFs if InversionIsFast(), and into sliding windows
+		of w bits otherwise, and are then processed together in one shared run of doublings.
+		If windowSizes is not NULL, windowSizes[i] is the w used for exponents[i], where 0 selects
+		a width from the length of the exponent. */
+	virtual Element MultiScalarMultiply(const Element *bases, const Integer *exponents, unsigned int count, const unsigned int *windowSizes = 0) const;
+
 	virtual void SimultaneousMultiply(Element *results, const Element &base, const Integer *exponents, unsigned int exponentsCount) const;
 };
 
@@ -63,6 +157,12 @@ public:
 
 	virtual void SimultaneousExponentiate(Element *results, const Element &base, const Integer *exponents, unsigned int exponentsCount) const;
 
+	//! replaces each of elements[0..count-1] by its multiplicative inverse, using a single inversion
+	/*! This is Montgomery's trick, which costs three multiplications per element instead of an
+		inversion. An element whose inverse doesn't exist is replaced by whatever MultiplicativeInverse()
+		returns for it, and doesn't affect the others, as long as that is Identity(). */
+	virtual void SimultaneousInverse(Element *elements, unsigned int count) const;
+
 	virtual const AbstractGroup<T>& MultiplicativeGroup() const
 		{return m_mg;}
 
@@ -131,6 +231,9 @@ template <class Element, class Iterator>
 	Element GeneralCascadeMultiplication(const AbstractGroup<Element> &group, Iterator begin, Iterator end);
 template <class Element, class Iterator>
 	Element GeneralCascadeExponentiation(const AbstractRing<Element> &ring, Iterator begin, Iterator end);
+//! replaces each element of [begin, end) by its multiplicative inverse, as AbstractRing::SimultaneousInverse() does
+template <class Element, class Iterator>
+	void ParallelInvert(const AbstractRing<Element> &ring, Iterator begin, Iterator end);
 
 // ********************************************************
 
@@ -145,8 +248,13 @@ public:
 	virtual const Element& Mod(const Element &a, const Element &b) const =0;
 	virtual const Element& Gcd(const Element &a, const Element &b) const;
 
+	~AbstractEuclideanDomain() {ArithmeticWorkspace::Release(result);}
+
 protected:
+	Element & Result() const {return ArithmeticWorkspace::Scratch(m_owner, result);}
+
 	mutable Element result;
+	ArithmeticWorkspace::Owner m_owner;
 };
 
 // ********************************************************
@@ -158,6 +266,7 @@ public:
 	typedef T Element;
 
 	EuclideanDomainOf() {}
+	~EuclideanDomainOf() {ArithmeticWorkspace::Release(result);}
 
 	bool Equal(const Element &a, const Element &b) const
 		{return a==b;}
@@ -166,43 +275,43 @@ public:
 		{return Element::Zero();}
 
 	const Element& Add(const Element &a, const Element &b) const
-		{return result = a+b;}
+		{return Result() = a+b;}
 
 	Element& Accumulate(Element &a, const Element &b) const
 		{return a+=b;}
 
 	const Element& Inverse(const Element &a) const
-		{return result = -a;}
+		{return Result() = -a;}
 
 	const Element& Subtract(const Element &a, const Element &b) const
-		{return result = a-b;}
+		{return Result() = a-b;}
 
 	Element& Reduce(Element &a, const Element &b) const
 		{return a-=b;}
 
 	const Element& Double(const Element &a) const
-		{return result = a.Doubled();}
+		{return Result() = a.Doubled();}
 
 	const Element& MultiplicativeIdentity() const
 		{return Element::One();}
 
 	const Element& Multiply(const Element &a, const Element &b) const
-		{return result = a*b;}
+		{return Result() = a*b;}
 
 	const Element& Square(const Element &a) const
-		{return result = a.Squared();}
+		{return Result() = a.Squared();}
 
 	bool IsUnit(const Element &a) const
 		{return a.IsUnit();}
 
 	const Element& MultiplicativeInverse(const Element &a) const
-		{return result = a.MultiplicativeInverse();}
+		{return Result() = a.MultiplicativeInverse();}
 
 	const Element& Divide(const Element &a, const Element &b) const
-		{return result = a/b;}
+		{return Result() = a/b;}
 
 	const Element& Mod(const Element &a, const Element &b) const
-		{return result = a%b;}
+		{return Result() = a%b;}
 
 	void DivisionAlgorithm(Element &r, Element &q, const Element &a, const Element &d) const
 		{Element::Divide(r, q, a, d);}
@@ -211,7 +320,10 @@ public:
 		{return true;}
 
 private:
+	Element & Result() const {return ArithmeticWorkspace::Scratch(m_owner, result);}
+
 	mutable Element result;
+	ArithmeticWorkspace::Owner m_owner;
 };
 
 //! Quotient Ring
@@ -36,6 +36,7 @@ CRYPTOPP_DEFINE_NAME_STRING(GroupOID)			//!< OID
 CRYPTOPP_DEFINE_NAME_STRING(PointerToPrimeSelector)		//!< const PrimeSelector *
 CRYPTOPP_DEFINE_NAME_STRING(Prime1)				//!< Integer
 CRYPTOPP_DEFINE_NAME_STRING(Prime2)				//!< Integer
+CRYPTOPP_DEFINE_NAME_STRING(PrimeCount)			//!< int, number of primes in an RSA modulus
 CRYPTOPP_DEFINE_NAME_STRING(ModPrime1PrivateExponent)	//!< Integer
 CRYPTOPP_DEFINE_NAME_STRING(ModPrime2PrivateExponent)	//!< Integer
 CRYPTOPP_DEFINE_NAME_STRING(MultiplicativeInverseOfPrime2ModPrime1)	//!< Integer
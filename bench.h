@@ -7,5 +7,6 @@ extern const double CLOCK_TICKS_PER_SECOND;
 
 void BenchmarkAll(double t, double hertz);
 void BenchmarkAll2(double t, double hertz);
+void TuneIntegerMultiplication(double t, const char *filename);
 
 #endif
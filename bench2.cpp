@@ -26,6 +26,7 @@
 #include <math.h>
 #include <iostream>
 #include <iomanip>
+#include <fstream>
 
 USING_NAMESPACE(CryptoPP)
 USING_NAMESPACE(std)
@@ -229,6 +230,96 @@ void BenchMarkKeyAgreement(const char *filename, const char *name, double timeTo
 
 extern double g_hertz;
 
+void BenchMarkInverse(const char *name, unsigned int bits, double timeTotal)
+{
+	Integer m(GlobalRNG(), bits), a, b(GlobalRNG(), bits);
+	m.SetBit(bits-1);
+	m.SetBit(0);
+	do a.Randomize(GlobalRNG(), Integer::One(), m-1);
+	while (!Integer::Gcd(a, m).IsUnit());
+
+	clock_t start = clock();
+	unsigned long i;
+	double timeTaken;
+	for (timeTaken=(double)0, i=0; timeTaken < timeTotal; timeTaken = double(clock() - start) / CLOCK_TICKS_PER_SECOND, i++)
+		a.InverseMod(m);
+
+	OutputResultOperations(name, "Modular Inverse", false, i, timeTaken);
+
+	start = clock();
+	for (timeTaken=(double)0, i=0; timeTaken < timeTotal; timeTaken = double(clock() - start) / CLOCK_TICKS_PER_SECOND, i++)
+		Integer::Gcd(b, m);
+
+	OutputResultOperations(name, "GCD", false, i, timeTaken);
+}
+
+static double TimeMultiplication(const Integer &a, const Integer &b, double timeTotal)
+{
+	Integer product;
+	clock_t start = clock();
+	unsigned long i;
+	double timeTaken;
+	for (timeTaken=(double)0, i=0; timeTaken < timeTotal; timeTaken = double(clock() - start) / CLOCK_TICKS_PER_SECOND, i++)
+		product = a.Times(b);
+
+	return timeTaken / i;
+}
+
+void TuneIntegerMultiplication(double t, const char *filename)
+{
+	size_t threshold = 0;
+
+	// a single Karatsuba step is compared with schoolbook multiplication at each size
+	cout << "Words\tSchoolbook (us)\tKaratsuba (us)" << endl;
+	Integer::SetToom3Threshold(0);
+	for (size_t words = 32; words <= 256; words *= 2)
+	{
+		Integer a(GlobalRNG(), words*WORD_BITS), b(GlobalRNG(), words*WORD_BITS);
+
+		Integer::SetKaratsubaThreshold(words+1);
+		double schoolbook = TimeMultiplication(a, b, t);
+		Integer::SetKaratsubaThreshold(words);
+		double karatsuba = TimeMultiplication(a, b, t);
+
+		cout << words << "\t" << schoolbook*1e6 << "\t" << karatsuba*1e6 << endl;
+
+		// the threshold is the smallest size from which Karatsuba is faster at every larger size,
+		// left at the default if that is the smallest size measured
+		if (karatsuba >= schoolbook)
+			threshold = words*2;
+	}
+	Integer::SetKaratsubaThreshold(threshold);
+
+	// Toom-3 only at the top level, so each size is compared on its own
+	threshold = 0;
+	cout << "\nWords\tKaratsuba (us)\tToom-3 (us)" << endl;
+	for (size_t words = 32; words <= 1024; words *= 2)
+	{
+		Integer a(GlobalRNG(), words*WORD_BITS), b(GlobalRNG(), words*WORD_BITS);
+
+		Integer::SetToom3Threshold(0);
+		double karatsuba = TimeMultiplication(a, b, t);
+		Integer::SetToom3Threshold(words);
+		double toom3 = TimeMultiplication(a, b, t);
+
+		cout << words << "\t" << karatsuba*1e6 << "\t" << toom3*1e6 << endl;
+
+		// the threshold is the smallest size from which Toom-3 is faster at every larger size
+		if (toom3 >= karatsuba)
+			threshold = 0;
+		else if (!threshold)
+			threshold = words;
+	}
+	Integer::SetToom3Threshold(threshold);
+
+	std::ofstream out(filename);
+	Integer::SaveTuning(out);
+	if (!out)
+		throw Exception(Exception::IO_ERROR, string("TuneIntegerMultiplication: cannot write ") + filename);
+	cout << "\nThe thresholds were written to " << filename << ". To use them, set the environment" << endl;
+	cout << "variable CRYPTOPP_INTEGER_TUNING to the name of that file." << endl;
+}
+
 void BenchmarkAll2(double t, double hertz)
 {
 	g_hertz = hertz;
@@ -313,5 +404,15 @@ void BenchmarkAll2(double t, double hertz)
 		BenchMarkKeyGen("ECMQVC over GF(2^n) 233", ecmqvc, t);
 		BenchMarkAgreement("ECMQVC over GF(2^n) 233", ecmqvc, t);
 	}
+
+	cout << "<TBODY style=\"background: white\">" << endl;
+	{
+		static const unsigned int sizes[] = {160, 256, 384, 521, 1024, 2048, 3072, 7680, 15360};
+		for (unsigned int i=0; i<sizeof(sizes)/sizeof(sizes[0]); i++)
+		{
+			std::string name = "Integer " + IntToString(sizes[i]);
+			BenchMarkInverse(name.c_str(), sizes[i], t);
+		}
+	}
 	cout << "</TABLE>" << endl;
 }
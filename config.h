@@ -46,6 +46,18 @@
 // set the name of Rijndael cipher, was "Rijndael" before version 5.3
 #define CRYPTOPP_RIJNDAEL_NAME "AES"
 
+// operand length in words from which Integer multiplication switches from Karatsuba to Toom-3,
+// or 0 to never use Toom-3. A tuning file written by "cryptest.exe tune" overrides this at
+// startup when the environment variable CRYPTOPP_INTEGER_TUNING names it.
+#ifndef CRYPTOPP_TOOM3_THRESHOLD
+#define CRYPTOPP_TOOM3_THRESHOLD 0
+#endif
+
+// Define this to route secure memory allocations through ScratchArena, which reuses the blocks
+// released during a signature operation. It costs a lookup on every allocation and only pays off
+// with heap allocators that have no per-thread cache; glibc's malloc is already as fast.
+// #define CRYPTOPP_SCRATCH_ARENA
+
 // ***************** Important Settings Again ********************
 // But the defaults should be ok.
 
@@ -278,6 +290,22 @@ NAMESPACE_END
 	#define CRYPTOPP_X64_ASM_AVAILABLE
 #endif
 
+// ADX and BMI2 were introduced in GNU as 2.23, which was released 10/22/2012, but we can't tell what version of binutils is installed.
+// GCC 4.8.0 was released on 3/22/2013, so we'll use that as a proxy for the binutils version.
+#if !defined(CRYPTOPP_DISABLE_ADX) && defined(CRYPTOPP_X64_ASM_AVAILABLE) && CRYPTOPP_GCC_VERSION >= 40800
+	#define CRYPTOPP_BOOL_ADX_ASM_AVAILABLE 1
+#else
+	#define CRYPTOPP_BOOL_ADX_ASM_AVAILABLE 0
+#endif
+
+// AVX-512 IFMA code is compiled for individual functions through the target attribute, which
+// GCC 5.1, released 4/22/2015, is the first version to accept, so we'll use that as a proxy for binutils too.
+#if !defined(CRYPTOPP_DISABLE_AVX512) && defined(CRYPTOPP_X64_ASM_AVAILABLE) && CRYPTOPP_GCC_VERSION >= 50100
+	#define CRYPTOPP_BOOL_AVX512IFMA_ASM_AVAILABLE 1
+#else
+	#define CRYPTOPP_BOOL_AVX512IFMA_ASM_AVAILABLE 0
+#endif
+
 #if !defined(CRYPTOPP_DISABLE_SSE2) && (defined(CRYPTOPP_MSVC6PP_OR_LATER) || defined(__SSE2__))
 	#define CRYPTOPP_BOOL_SSE2_INTRINSICS_AVAILABLE 1
 #else
@@ -403,6 +431,19 @@ NAMESPACE_END
 
 #endif	// NO_OS_DEPENDENCE
 
+// std::atomic keeps the counters of objects that threads share, such as DL public keys with adaptive precomputation;
+// without it those counters are plain variables, and such objects may only be used by one thread at a time
+#if !defined(CRYPTOPP_NO_CXX11_ATOMICS) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1700))
+#	define CRYPTOPP_CXX11_ATOMICS
+#endif
+
+// lets static objects with trivial constructors, such as AtomicValue, be initialized before any code runs
+#if __cplusplus >= 201103L
+#	define CRYPTOPP_CONSTEXPR constexpr
+#else
+#	define CRYPTOPP_CONSTEXPR
+#endif
+
 // ***************** DLL related ********************
 
 #if defined(CRYPTOPP_WIN32_AVAILABLE) && !defined(CRYPTOPP_DOXYGEN_PROCESSING)
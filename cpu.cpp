@@ -25,7 +25,11 @@ NAMESPACE_BEGIN(CryptoPP)
 
 bool CpuId(word32 input, word32 *output)
 {
+#if _MSC_FULL_VER >= 150030729
+	__cpuidex((int *)output, input, 0);
+#else
 	__cpuid((int *)output, input);
+#endif
 	return true;
 }
 
@@ -57,6 +61,7 @@ bool CpuId(word32 input, word32 *output)
 		__asm
 		{
 			mov eax, input
+			xor ecx, ecx
 			cpuid
 			mov edi, output
 			mov [edi], eax
@@ -89,7 +94,7 @@ bool CpuId(word32 input, word32 *output)
 			"pushq %%rbx; cpuid; mov %%ebx, %%edi; popq %%rbx"
 #endif
 			: "=a" (output[0]), "=D" (output[1]), "=c" (output[2]), "=d" (output[3])
-			: "a" (input)
+			: "a" (input), "2" (0)	// subleaf 0 for the leaves that have them
 		);
 	}
 
@@ -100,6 +105,18 @@ bool CpuId(word32 input, word32 *output)
 
 #endif
 
+// returns the register state the OS saves on context switches, bits 5 to 7 are the AVX-512 state
+static word64 XGetBV()
+{
+#if defined(__GNUC__)
+	word32 lo, hi;
+	asm (".byte 0x0f, 0x01, 0xd0" : "=a" (lo), "=d" (hi) : "c" (0));	// xgetbv
+	return (word64(hi) << 32) | lo;
+#else
+	return 0;
+#endif
+}
+
 static bool TrySSE2()
 {
 #if CRYPTOPP_BOOL_X64
@@ -143,7 +160,7 @@ static bool TrySSE2()
 }
 
 bool g_x86DetectionDone = false;
-bool g_hasISSE = false, g_hasSSE2 = false, g_hasSSSE3 = false, g_hasMMX = false, g_hasAESNI = false, g_hasCLMUL = false, g_isP4 = false;
+bool g_hasISSE = false, g_hasSSE2 = false, g_hasSSSE3 = false, g_hasMMX = false, g_hasAESNI = false, g_hasCLMUL = false, g_hasBMI2 = false, g_hasADX = false, g_hasAVX512IFMA = false, g_isP4 = false;
 word32 g_cacheLineSize = CRYPTOPP_L1_CACHE_LINE_SIZE;
 
 void DetectX86Features()
@@ -161,6 +178,19 @@ void DetectX86Features()
 	g_hasAESNI = g_hasSSE2 && (cpuid1[2] & (1<<25));
 	g_hasCLMUL = g_hasSSE2 && (cpuid1[2] & (1<<1));
 
+	if (cpuid[0] >= 7)
+	{
+		word32 cpuid7[4];
+		if (CpuId(7, cpuid7))
+		{
+			g_hasBMI2 = (cpuid7[1] & (1 << 8)) != 0;
+			g_hasADX = (cpuid7[1] & (1 << 19)) != 0;
+			// AVX-512F and IFMA, usable only if OSXSAVE is set and the OS saves the XMM, YMM and ZMM state
+			if ((cpuid7[1] & (1 << 16)) && (cpuid7[1] & (1 << 21)) && (cpuid1[2] & (1 << 27)))
+				g_hasAVX512IFMA = (XGetBV() & 0xe6) == 0xe6;
+		}
+	}
+
 	if ((cpuid1[3] & (1 << 25)) != 0)
 		g_hasISSE = true;
 	else
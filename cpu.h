@@ -105,6 +105,9 @@ extern CRYPTOPP_DLL bool g_x86DetectionDone;
 extern CRYPTOPP_DLL bool g_hasSSSE3;
 extern CRYPTOPP_DLL bool g_hasAESNI;
 extern CRYPTOPP_DLL bool g_hasCLMUL;
+extern CRYPTOPP_DLL bool g_hasBMI2;
+extern CRYPTOPP_DLL bool g_hasADX;
+extern CRYPTOPP_DLL bool g_hasAVX512IFMA;
 extern CRYPTOPP_DLL bool g_isP4;
 extern CRYPTOPP_DLL word32 g_cacheLineSize;
 CRYPTOPP_DLL void CRYPTOPP_API DetectX86Features();
@@ -164,6 +167,28 @@ inline bool HasCLMUL()
 	return g_hasCLMUL;
 }
 
+inline bool HasBMI2()
+{
+	if (!g_x86DetectionDone)
+		DetectX86Features();
+	return g_hasBMI2;
+}
+
+inline bool HasADX()
+{
+	if (!g_x86DetectionDone)
+		DetectX86Features();
+	return g_hasADX;
+}
+
+//! returns whether the CPU has AVX-512 IFMA and the OS saves the AVX-512 register state
+inline bool HasAVX512IFMA()
+{
+	if (!g_x86DetectionDone)
+		DetectX86Features();
+	return g_hasAVX512IFMA;
+}
+
 inline bool IsP4()
 {
 	if (!g_x86DetectionDone)
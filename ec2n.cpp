@@ -184,10 +184,11 @@ const EC2N::Point& EC2N::Inverse(const Point &P) const
 		return P;
 	else
 	{
-		m_R.identity = false;
-		m_R.y = m_field->Add(P.x, P.y);
-		m_R.x = P.x;
-		return m_R;
+		Point &R = Result();
+		R.identity = false;
+		R.y = m_field->Add(P.x, P.y);
+		R.x = P.x;
+		return R;
 	}
 }
 
@@ -204,13 +205,14 @@ const EC2N::Point& EC2N::Add(const Point &P, const Point &Q) const
 	m_field->Accumulate(x, t);
 	m_field->Accumulate(x, Q.x);
 	m_field->Accumulate(x, m_a);
-	m_R.y = m_field->Add(P.y, m_field->Multiply(t, x));
+	Point &R = Result();
+	R.y = m_field->Add(P.y, m_field->Multiply(t, x));
 	m_field->Accumulate(x, P.x);
-	m_field->Accumulate(m_R.y, x);
+	m_field->Accumulate(R.y, x);
 
-	m_R.x.swap(x);
-	m_R.identity = false;
-	return m_R;
+	R.x.swap(x);
+	R.identity = false;
+	return R;
 }
 
 const EC2N::Point& EC2N::Double(const Point &P) const
@@ -220,15 +222,16 @@ const EC2N::Point& EC2N::Double(const Point &P) const
 
 	FieldElement t = m_field->Divide(P.y, P.x);
 	m_field->Accumulate(t, P.x);
-	m_R.y = m_field->Square(P.x);
-	m_R.x = m_field->Square(t);
-	m_field->Accumulate(m_R.x, t);
-	m_field->Accumulate(m_R.x, m_a);
-	m_field->Accumulate(m_R.y, m_field->Multiply(t, m_R.x));
-	m_field->Accumulate(m_R.y, m_R.x);
-
-	m_R.identity = false;
-	return m_R;
+	Point &R = Result();
+	R.y = m_field->Square(P.x);
+	R.x = m_field->Square(t);
+	m_field->Accumulate(R.x, t);
+	m_field->Accumulate(R.x, m_a);
+	m_field->Accumulate(R.y, m_field->Multiply(t, R.x));
+	m_field->Accumulate(R.y, R.x);
+
+	R.identity = false;
+	return R;
 }
 
 // ********************************************************
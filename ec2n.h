@@ -40,6 +40,7 @@ public:
 	// construct from BER encoded parameters
 	// this constructor will decode and extract the the fields fieldID and curve of the sequence ECParameters
 	EC2N(BufferedTransformation &bt);
+	~EC2N() {ArithmeticWorkspace::Release(m_R);}
 
 	// encode the fields fieldID and curve of the sequence ECParameters
 	void DEREncode(BufferedTransformation &bt) const;
@@ -79,9 +80,12 @@ public:
 		{return GetField() == rhs.GetField() && m_a == rhs.m_a && m_b == rhs.m_b;}
 
 private:
+	Point & Result() const {return ArithmeticWorkspace::Scratch(m_owner, m_R);}
+
 	clonable_ptr<Field> m_field;
 	FieldElement m_a, m_b;
 	mutable Point m_R;
+	ArithmeticWorkspace::Owner m_owner;
 };
 
 CRYPTOPP_DLL_TEMPLATE_CLASS DL_FixedBasePrecomputationImpl<EC2N::Point>;
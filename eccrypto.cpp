@@ -441,6 +441,7 @@ template <class EC> void DL_GroupParameters_EC<EC>::Initialize(const OID &oid)
 	StringSource ssN(param.n, true, new HexDecoder);
 	m_n.Decode(ssN, (size_t)ssN.MaxRetrievable());
 	m_k = param.h;
+	this->SubgroupOrderChanged();
 }
 
 template <class EC>
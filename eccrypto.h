@@ -46,6 +46,7 @@ public:
 		this->SetSubgroupGenerator(G);
 		m_n = n;
 		m_k = k;
+		this->SubgroupOrderChanged();
 	}
 	void Initialize(const OID &oid);
 
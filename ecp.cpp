@@ -208,10 +208,11 @@ const ECP::Point& ECP::Inverse(const Point &P) const
 		return P;
 	else
 	{
-		m_R.identity = false;
-		m_R.x = P.x;
-		m_R.y = GetField().Inverse(P.y);
-		return m_R;
+		Point &R = Result();
+		R.identity = false;
+		R.x = P.x;
+		R.y = GetField().Inverse(P.y);
+		return R;
 	}
 }
 
@@ -225,11 +226,12 @@ const ECP::Point& ECP::Add(const Point &P, const Point &Q) const
 	FieldElement t = GetField().Subtract(Q.y, P.y);
 	t = GetField().Divide(t, GetField().Subtract(Q.x, P.x));
 	FieldElement x = GetField().Subtract(GetField().Subtract(GetField().Square(t), P.x), Q.x);
-	m_R.y = GetField().Subtract(GetField().Multiply(t, GetField().Subtract(P.x, x)), P.y);
+	Point &R = Result();
+	R.y = GetField().Subtract(GetField().Multiply(t, GetField().Subtract(P.x, x)), P.y);
 
-	m_R.x.swap(x);
-	m_R.identity = false;
-	return m_R;
+	R.x.swap(x);
+	R.identity = false;
+	return R;
 }
 
 const ECP::Point& ECP::Double(const Point &P) const
@@ -240,58 +242,15 @@ const ECP::Point& ECP::Double(const Point &P) const
 	t = GetField().Add(GetField().Add(GetField().Double(t), t), m_a);
 	t = GetField().Divide(t, GetField().Double(P.y));
 	FieldElement x = GetField().Subtract(GetField().Subtract(GetField().Square(t), P.x), P.x);
-	m_R.y = GetField().Subtract(GetField().Multiply(t, GetField().Subtract(P.x, x)), P.y);
+	Point &R = Result();
+	R.y = GetField().Subtract(GetField().Multiply(t, GetField().Subtract(P.x, x)), P.y);
 
-	m_R.x.swap(x);
-	m_R.identity = false;
-	return m_R;
+	R.x.swap(x);
+	R.identity = false;
+	return R;
 }
 
-template <class T, class Iterator> void ParallelInvert(const AbstractRing<T> &ring, Iterator begin, Iterator end)
-{
-	size_t n = end-begin;
-	if (n == 1)
-		*begin = ring.MultiplicativeInverse(*begin);
-	else if (n > 1)
-	{
-		std::vector<T> vec((n+1)/2);
-		unsigned int i;
-		Iterator it;
-
-		for (i=0, it=begin; i<n/2; i++, it+=2)
-			vec[i] = ring.Multiply(*it, *(it+1));
-		if (n%2 == 1)
-			vec[n/2] = *it;
-
-		ParallelInvert(ring, vec.begin(), vec.end());
-
-		for (i=0, it=begin; i<n/2; i++, it+=2)
-		{
-			if (!vec[i])
-			{
-				*it = ring.MultiplicativeInverse(*it);
-				*(it+1) = ring.MultiplicativeInverse(*(it+1));
-			}
-			else
-			{
-				std::swap(*it, *(it+1));
-				*it = ring.Multiply(*it, vec[i]);
-				*(it+1) = ring.Multiply(*(it+1), vec[i]);
-			}
-		}
-		if (n%2 == 1)
-			*it = vec[n/2];
-	}
-}
-
-struct ProjectivePoint
-{
-	ProjectivePoint() {}
-	ProjectivePoint(const Integer &x, const Integer &y, const Integer &z)
-		: x(x), y(y), z(z)	{}
-
-	Integer x,y,z;
-};
+typedef ECPJacobianPoint ProjectivePoint;
 
 class ProjectiveDoubling
 {
@@ -348,14 +307,312 @@ struct ZIterator
 	std::vector<ProjectivePoint>::iterator it;
 };
 
+// Jacobian point arithmetic that keeps its temporaries between operations, and looks
+// at the curve's a once so that doubling can use the cheaper formulas for a = 0 and a = -3
+class JacobianArithmetic
+{
+public:
+	JacobianArithmetic(const ModularArithmetic &field, const Integer &a)
+		: field(field), a(a), aIsZero(a.IsZero())
+	{
+		aIsMinus3 = field.Equal(a, field.Inverse(field.ConvertIn(Integer(3))));
+	}
+
+	void Double(ProjectivePoint &P)
+	{
+		if (P.z.IsZero() || P.y.IsZero())
+		{
+			P.z = Integer::Zero();
+			return;
+		}
+
+		XX = field.Square(P.x);
+		YY = field.Square(P.y);
+		ZZ = field.Square(P.z);
+
+		// z' = 2yz
+		P.z = field.Multiply(P.y, P.z);
+		P.z = field.Double(P.z);
+
+		// S = 4xy^2
+		S = field.Multiply(P.x, YY);
+		S = field.Double(S);
+		S = field.Double(S);
+
+		// M = 3x^2 + az^4
+		if (aIsMinus3)
+		{
+			T = field.Subtract(P.x, ZZ);
+			M = field.Add(P.x, ZZ);
+			M = field.Multiply(M, T);
+			T = field.Double(M);
+			field.Accumulate(M, T);
+		}
+		else
+		{
+			M = field.Double(XX);
+			field.Accumulate(M, XX);
+			if (!aIsZero)
+			{
+				T = field.Square(ZZ);
+				T = field.Multiply(T, a);
+				field.Accumulate(M, T);
+			}
+		}
+
+		// x' = M^2 - 2S
+		P.x = field.Square(M);
+		field.Reduce(P.x, S);
+		field.Reduce(P.x, S);
+
+		// y' = M(S - x') - 8y^4
+		field.Reduce(S, P.x);
+		P.y = field.Multiply(M, S);
+		T = field.Square(YY);
+		T = field.Double(T);
+		T = field.Double(T);
+		T = field.Double(T);
+		field.Reduce(P.y, T);
+	}
+
+	void Add(ProjectivePoint &P, const ProjectivePoint &Q)
+	{
+		if (Q.z.IsZero())
+			return;
+		if (P.z.IsZero())
+		{
+			P = Q;
+			return;
+		}
+
+		// U1 = x1 z2^2, H = x2 z1^2 - U1, S1 = y1 z2^3, R = y2 z1^3 - S1
+		ZZ = field.Square(P.z);
+		T = field.Square(Q.z);
+		U1 = field.Multiply(P.x, T);
+		H = field.Multiply(Q.x, ZZ);
+		field.Reduce(H, U1);
+		T = field.Multiply(T, Q.z);
+		S1 = field.Multiply(P.y, T);
+		T = field.Multiply(ZZ, P.z);
+		R = field.Multiply(Q.y, T);
+		field.Reduce(R, S1);
+
+		if (H.IsZero())
+		{
+			if (R.IsZero())
+				Double(P);
+			else
+				P.z = Integer::Zero();
+			return;
+		}
+
+		// z' = z1 z2 H
+		P.z = field.Multiply(P.z, Q.z);
+		P.z = field.Multiply(P.z, H);
+		Finish(P);
+	}
+
+	// adds the affine point Q, or its inverse if negate is set
+	void Add(ProjectivePoint &P, const ECPPoint &Q, bool negate = false)
+	{
+		if (Q.identity)
+			return;
+		if (P.z.IsZero())
+		{
+			P.x = Q.x;
+			P.y = negate ? field.Inverse(Q.y) : Q.y;
+			P.z = field.MultiplicativeIdentity();
+			return;
+		}
+
+		// as above with z2 = 1
+		ZZ = field.Square(P.z);
+		H = field.Multiply(Q.x, ZZ);
+		field.Reduce(H, P.x);
+		T = field.Multiply(ZZ, P.z);
+		R = field.Multiply(Q.y, T);
+		if (negate)
+			R = field.Inverse(R);
+		field.Reduce(R, P.y);
+
+		if (H.IsZero())
+		{
+			if (R.IsZero())
+				Double(P);
+			else
+				P.z = Integer::Zero();
+			return;
+		}
+
+		U1 = P.x;
+		S1 = P.y;
+		P.z = field.Multiply(P.z, H);
+		Finish(P);
+	}
+
+private:
+	// x' = R^2 - H^3 - 2 U1 H^2, y' = R(U1 H^2 - x') - S1 H^3
+	void Finish(ProjectivePoint &P)
+	{
+		XX = field.Square(H);
+		YY = field.Multiply(H, XX);
+		U1 = field.Multiply(U1, XX);
+		S1 = field.Multiply(S1, YY);
+
+		P.x = field.Square(R);
+		field.Reduce(P.x, YY);
+		field.Reduce(P.x, U1);
+		field.Reduce(P.x, U1);
+
+		field.Reduce(U1, P.x);
+		P.y = field.Multiply(R, U1);
+		field.Reduce(P.y, S1);
+	}
+
+	const ModularArithmetic &field;
+	const Integer &a;
+	bool aIsZero, aIsMinus3;
+	Integer XX, YY, ZZ, S, M, T, U1, S1, H, R;
+};
+
+// Returns the sum of exponents[i]*bases[i]. Each exponent is recoded into a width-w NAF, the odd
+// multiples of its base that the digits need are computed and made affine with a single inversion
+// for all bases, and then the digits of all exponents are added with mixed additions during one
+// shared run of doublings, which is converted to affine at the end.
+static ECP::Point InterleavedMultiply(const ECP &ec, const ECP::Point *bases, const Integer *exponents, unsigned int count, const unsigned int *windowSizes)
+{
+	const ModularArithmetic &field = ec.GetField();
+	JacobianArithmetic arithmetic(field, ec.GetA());
+	std::vector<ECP::Point> table;
+	std::vector<ProjectivePoint> multiples;		// table entries other than the bases, still to be made affine
+	std::vector<size_t> multipleIndices;
+	std::vector<ScalarDigit> digits;
+
+	for (unsigned int i=0; i<count; i++)
+	{
+		if (bases[i].identity || exponents[i].IsZero())
+			continue;
+
+		ECP::Point base = bases[i];
+		Integer exponent = exponents[i];
+		if (exponent.IsNegative())
+		{
+			exponent.Negate();
+			base.y = field.Inverse(base.y);
+		}
+
+		unsigned int windowSize = ScalarWindowSize(exponent.BitCount(), true, windowSizes ? windowSizes[i] : 0);
+		size_t first = table.size(), tableSize = ScalarTableSize(windowSize, true);
+		table.push_back(base);
+		if (tableSize > 1)
+		{
+			ProjectivePoint next(base.x, base.y, field.MultiplicativeIdentity()), twice(next);
+			arithmetic.Double(twice);
+			for (size_t j=1; j<tableSize; j++)
+			{
+				arithmetic.Add(next, twice);
+				multipleIndices.push_back(table.size());
+				multiples.push_back(next);
+				table.push_back(ECP::Point());
+			}
+		}
+
+		AppendScalarDigits(digits, first, exponent, windowSize, true);
+	}
+
+	if (digits.empty())
+		return ec.Identity();
+
+	if (!multiples.empty())
+	{
+		std::vector<ECP::Point> affine(multiples.size());
+		ec.ToAffine(&affine[0], &multiples[0], multiples.size());
+		for (size_t i=0; i<affine.size(); i++)
+			table[multipleIndices[i]] = affine[i];
+	}
+	std::sort(digits.begin(), digits.end());
+
+	ProjectivePoint result;
+	std::vector<ScalarDigit>::const_iterator digit = digits.begin();
+	for (unsigned int position = digit->position; ; position--)
+	{
+		for (; digit != digits.end() && digit->position == position; ++digit)
+			arithmetic.Add(result, table[digit->index], digit->negate);
+		if (position == 0)
+			break;
+		arithmetic.Double(result);
+	}
+
+	return ec.ToAffine(result);
+}
+
+ECP::JacobianPoint ECP::ToJacobian(const Point &P) const
+{
+	return P.identity ? JacobianPoint() : JacobianPoint(P.x, P.y, GetField().MultiplicativeIdentity());
+}
+
+ECP::Point ECP::ToAffine(const JacobianPoint &P) const
+{
+	Point R;
+	ToAffine(&R, &P, 1);
+	return R;
+}
+
+void ECP::ToAffine(Point *results, const JacobianPoint *points, size_t count) const
+{
+	std::vector<ProjectivePoint> inverses(points, points+count);
+	ParallelInvert(GetField(), ZIterator(inverses.begin()), ZIterator(inverses.end()));
+
+	for (size_t i=0; i<count; i++)
+	{
+		if (points[i].z.IsZero())
+		{
+			results[i] = Identity();
+			continue;
+		}
+
+		// x/z^2, y/z^3
+		const Integer &zInverse = inverses[i].z;
+		Integer t = GetField().Square(zInverse);
+		results[i].identity = false;
+		results[i].x = GetField().Multiply(points[i].x, t);
+		t = GetField().Multiply(t, zInverse);
+		results[i].y = GetField().Multiply(points[i].y, t);
+	}
+}
+
+ECP::JacobianPoint ECP::JacobianDouble(const JacobianPoint &P) const
+{
+	JacobianPoint R(P);
+	JacobianArithmetic(GetField(), m_a).Double(R);
+	return R;
+}
+
+ECP::JacobianPoint ECP::JacobianAdd(const JacobianPoint &P, const JacobianPoint &Q) const
+{
+	JacobianPoint R(P);
+	JacobianArithmetic(GetField(), m_a).Add(R, Q);
+	return R;
+}
+
+ECP::JacobianPoint ECP::JacobianAdd(const JacobianPoint &P, const Point &Q) const
+{
+	JacobianPoint R(P);
+	JacobianArithmetic(GetField(), m_a).Add(R, Q);
+	return R;
+}
+
 ECP::Point ECP::ScalarMultiply(const Point &P, const Integer &k) const
 {
-	Element result;
-	if (k.BitCount() <= 5)
-		AbstractGroup<ECPPoint>::SimultaneousMultiply(&result, P, &k, 1);
-	else
-		ECP::SimultaneousMultiply(&result, P, &k, 1);
-	return result;
+	// converting to Montgomery representation only pays off for longer exponents
+	if (!GetField().IsMontgomeryRepresentation() && k.BitCount() > 5)
+	{
+		ECP ecpmr(*this, true);
+		const ModularArithmetic &mr = ecpmr.GetField();
+		return FromMontgomery(mr, ecpmr.ScalarMultiply(ToMontgomery(mr, P), k));
+	}
+
+	return InterleavedMultiply(*this, &P, &k, 1, NULL);
 }
 
 void ECP::SimultaneousMultiply(ECP::Point *results, const ECP::Point &P, const Integer *expBegin, unsigned int expCount) const
@@ -452,20 +709,39 @@ void ECP::SimultaneousMultiply(ECP::Point *results, const ECP::Point &P, const I
 			}
 			finalCascade[j].exponent = Integer(Integer::POSITIVE, 0, exponentWindows[i][j]);
 		}
-		results[i] = GeneralCascadeMultiplication(*this, finalCascade.begin(), finalCascade.end());
+		// exponents that are powers of 2, as in fixed base precomputations, need no further work
+		if (finalCascade.size() == 1 && finalCascade[0].exponent == Integer::One())
+			results[i] = finalCascade[0].base;
+		else
+			results[i] = GeneralCascadeMultiplication(*this, finalCascade.begin(), finalCascade.end());
 	}
 }
 
 ECP::Point ECP::CascadeScalarMultiply(const Point &P, const Integer &k1, const Point &Q, const Integer &k2) const
 {
-	if (!GetField().IsMontgomeryRepresentation())
+	const Point bases[2] = {P, Q};
+	const Integer exponents[2] = {k1, k2};
+	return MultiScalarMultiply(bases, exponents, 2);
+}
+
+ECP::Point ECP::MultiScalarMultiply(const Point *bases, const Integer *exponents, unsigned int count, const unsigned int *windowSizes) const
+{
+	unsigned int expLen = 0;
+	for (unsigned int i=0; i<count; i++)
+		expLen = STDMAX(expLen, exponents[i].BitCount());
+
+	// converting to Montgomery representation only pays off for longer exponents
+	if (!GetField().IsMontgomeryRepresentation() && expLen > 5)
 	{
 		ECP ecpmr(*this, true);
 		const ModularArithmetic &mr = ecpmr.GetField();
-		return FromMontgomery(mr, ecpmr.CascadeScalarMultiply(ToMontgomery(mr, P), k1, ToMontgomery(mr, Q), k2));
+		std::vector<Point> mrBases(count);
+		for (unsigned int i=0; i<count; i++)
+			mrBases[i] = ToMontgomery(mr, bases[i]);
+		return FromMontgomery(mr, InterleavedMultiply(ecpmr, &mrBases[0], exponents, count, windowSizes));
 	}
-	else
-		return AbstractGroup<Point>::CascadeScalarMultiply(P, k1, Q, k2);
+
+	return InterleavedMultiply(*this, bases, exponents, count, windowSizes);
 }
 
 NAMESPACE_END
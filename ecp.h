@@ -24,6 +24,20 @@ struct CRYPTOPP_DLL ECPPoint
 	Integer x, y;
 };
 
+//! Elliptical Curve Point in Jacobian coordinates
+/*! (x, y, z) stands for the affine point (x/z^2, y/z^3), and any point with z = 0 for the point at infinity.
+	Adding and doubling such points needs no field inversions. */
+struct CRYPTOPP_DLL ECPJacobianPoint
+{
+	ECPJacobianPoint() {}
+	ECPJacobianPoint(const Integer &x, const Integer &y, const Integer &z)
+		: x(x), y(y), z(z) {}
+
+	bool IsIdentity() const {return z.IsZero();}
+
+	Integer x, y, z;
+};
+
 CRYPTOPP_DLL_TEMPLATE_CLASS AbstractGroup<ECPPoint>;
 
 //! Elliptic Curve over GF(p), where p is prime
@@ -33,6 +47,7 @@ public:
 	typedef ModularArithmetic Field;
 	typedef Integer FieldElement;
 	typedef ECPPoint Point;
+	typedef ECPJacobianPoint JacobianPoint;
 
 	ECP() {}
 	ECP(const ECP &ecp, bool convertToMontgomeryRepresentation = false);
@@ -41,6 +56,7 @@ public:
 	// construct from BER encoded parameters
 	// this constructor will decode and extract the the fields fieldID and curve of the sequence ECParameters
 	ECP(BufferedTransformation &bt);
+	~ECP() {ArithmeticWorkspace::Release(m_R);}
 
 	// encode the fields fieldID and curve of the sequence ECParameters
 	void DEREncode(BufferedTransformation &bt) const;
@@ -53,8 +69,19 @@ public:
 	const Point& Double(const Point &P) const;
 	Point ScalarMultiply(const Point &P, const Integer &k) const;
 	Point CascadeScalarMultiply(const Point &P, const Integer &k1, const Point &Q, const Integer &k2) const;
+	Point MultiScalarMultiply(const Point *bases, const Integer *exponents, unsigned int count, const unsigned int *windowSizes = NULL) const;
 	void SimultaneousMultiply(Point *results, const Point &base, const Integer *exponents, unsigned int exponentsCount) const;
 
+	// Jacobian coordinates, in the representation of GetField()
+	JacobianPoint ToJacobian(const Point &P) const;
+	Point ToAffine(const JacobianPoint &P) const;
+	//! converts count points with a single field inversion
+	void ToAffine(Point *results, const JacobianPoint *points, size_t count) const;
+	JacobianPoint JacobianDouble(const JacobianPoint &P) const;
+	JacobianPoint JacobianAdd(const JacobianPoint &P, const JacobianPoint &Q) const;
+	//! adds an affine point to a Jacobian one, which is cheaper than adding two Jacobian points
+	JacobianPoint JacobianAdd(const JacobianPoint &P, const Point &Q) const;
+
 	Point Multiply(const Integer &k, const Point &P) const
 		{return ScalarMultiply(P, k);}
 	Point CascadeMultiply(const Integer &k1, const Point &P, const Integer &k2, const Point &Q) const
@@ -83,9 +110,12 @@ public:
 		{return GetField() == rhs.GetField() && m_a == rhs.m_a && m_b == rhs.m_b;}
 
 private:
+	Point & Result() const {return ArithmeticWorkspace::Scratch(m_owner, m_R);}
+
 	clonable_ptr<Field> m_fieldPtr;
 	FieldElement m_a, m_b;
 	mutable Point m_R;
+	ArithmeticWorkspace::Owner m_owner;
 };
 
 CRYPTOPP_DLL_TEMPLATE_CLASS DL_FixedBasePrecomputationImpl<ECP::Point>;
@@ -35,8 +35,14 @@ template <class T> void DL_FixedBasePrecomputationImpl<T>::Precompute(const DL_G
 	}
 
 	m_bases.resize(storage);
-	for (unsigned i=1; i<storage; i++)
-		m_bases[i] = group.GetGroup().ScalarMultiply(m_bases[i-1], m_exponentBase);
+	if (storage > 1)
+	{
+		// one call lets groups such as ECP share the work of normalizing the results
+		std::vector<Integer> exponents(storage-1);
+		for (unsigned i=1; i<storage; i++)
+			exponents[i-1] = Integer::Power2(i*m_windowSize);
+		group.GetGroup().SimultaneousMultiply(&m_bases[1], m_bases[0], &exponents[0], storage-1);
+	}
 }
 
 template <class T> void DL_FixedBasePrecomputationImpl<T>::Load(const DL_GroupPrecomputation<Element> &group, BufferedTransformation &bt)
@@ -28,6 +28,8 @@ public:
 	typedef T Element;
 
 	virtual bool IsInitialized() const =0;
+	//! returns true if the base has a table of more than one element, from Precompute() or Load()
+	virtual bool IsPrecomputed() const =0;
 	virtual void SetBase(const DL_GroupPrecomputation<Element> &group, const Element &base) =0;
 	virtual const Element & GetBase(const DL_GroupPrecomputation<Element> &group) const =0;
 	virtual void Precompute(const DL_GroupPrecomputation<Element> &group, unsigned int maxExpBits, unsigned int storage) =0;
@@ -48,6 +50,8 @@ public:
 	// DL_FixedBasePrecomputation
 	bool IsInitialized() const
 		{return !m_bases.empty();}
+	bool IsPrecomputed() const
+		{return m_bases.size() > 1;}
 	void SetBase(const DL_GroupPrecomputation<Element> &group, const Element &base);
 	const Element & GetBase(const DL_GroupPrecomputation<Element> &group) const
 		{return group.NeedConversions() ? m_base : m_bases[0];}
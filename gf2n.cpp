@@ -716,12 +716,14 @@ const GF2NT::Element& GF2NT::MultiplicativeInverse(const Element &a) const
 			b[t0/WORD_BITS-1] ^= temp;
 	}
 
+	Element &result = Result();
 	CopyWords(result.reg.begin(), b, result.reg.size());
 	return result;
 }
 
 const GF2NT::Element& GF2NT::Multiply(const Element &a, const Element &b) const
 {
+	Element &result = Result();
 	size_t aSize = STDMIN(a.reg.size(), result.reg.size());
 	Element r((word)0, m);
 
@@ -795,6 +797,7 @@ const GF2NT::Element& GF2NT::Reduced(const Element &a) const
 			b[i-(t0-t1)/WORD_BITS] ^= temp;
 	}
 
+	Element &result = Result();
 	SetWords(result.reg.begin(), 0, result.reg.size());
 	CopyWords(result.reg.begin(), b, STDMIN(b.size(), result.reg.size()));
 	return result;
@@ -319,6 +319,7 @@ class CRYPTOPP_DLL GF2NT : public GF2NP
 public:
 	// polynomial modulus = x^t0 + x^t1 + x^t2, t0 > t1 > t2
 	GF2NT(unsigned int t0, unsigned int t1, unsigned int t2);
+	~GF2NT() {ArithmeticWorkspace::Release(result);}
 
 	GF2NP * Clone() const {return new GF2NT(*this);}
 	void DEREncode(BufferedTransformation &bt) const;
@@ -332,9 +333,11 @@ public:
 
 private:
 	const Element& Reduced(const Element &a) const;
+	Element & Result() const {return ArithmeticWorkspace::Scratch(m_owner, result);}
 
 	unsigned int t0, t1;
 	mutable PolynomialMod2 result;
+	ArithmeticWorkspace::Owner m_owner;
 };
 
 //! GF(2^n) with Pentanomial Basis
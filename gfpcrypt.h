@@ -65,7 +65,7 @@ public:
 	virtual void SetModulusAndSubgroupGenerator(const Integer &p, const Integer &g) =0;
 
 	void SetSubgroupOrder(const Integer &q)
-		{m_q = q; ParametersChanged();}
+		{m_q = q; SubgroupOrderChanged();}
 
 protected:
 	Integer ComputeGroupOrder(const Integer &modulus) const
@@ -156,24 +156,69 @@ public:
 
 	void Sign(const DL_GroupParameters<T> &params, const Integer &x, const Integer &k, const Integer &e, Integer &r, Integer &s) const
 	{
-		const Integer &q = params.GetSubgroupOrder();
-		r %= q;
-		Integer kInv = k.InverseMod(q);
-		s = (kInv * (x*r + e)) % q;
+		const BarrettReducer &q = params.GetSubgroupOrderReducer();
+		r = q.Reduce(r);
+		Integer kInv = k.InverseMod(q.GetModulus());
+		s = q.Multiply(kInv, q.Reduce(x*r + e));
 		assert(!!r && !!s);
 	}
 
+	void SignBatch(const DL_GroupParameters<T> &params, const Integer &x, size_t count, const Integer *k, const Integer *e, Integer *r, Integer *s) const
+	{
+		const BarrettReducer &q = params.GetSubgroupOrderReducer();
+		std::vector<Integer> kInv(k, k+count);
+		ModularArithmetic(q.GetModulus()).SimultaneousInverse(&kInv[0], (unsigned int)count);
+		for (size_t i=0; i<count; i++)
+		{
+			r[i] = q.Reduce(r[i]);
+			s[i] = q.Multiply(kInv[i], q.Reduce(x*r[i] + e[i]));
+			assert(!!r[i] && !!s[i]);
+		}
+	}
+
 	bool Verify(const DL_GroupParameters<T> &params, const DL_PublicKey<T> &publicKey, const Integer &e, const Integer &r, const Integer &s) const
 	{
+		const BarrettReducer &reducer = params.GetSubgroupOrderReducer();
 		const Integer &q = params.GetSubgroupOrder();
 		if (r>=q || r<1 || s>=q || s<1)
 			return false;
 
 		Integer w = s.InverseMod(q);
-		Integer u1 = (e * w) % q;
-		Integer u2 = (r * w) % q;
+		Integer u1 = reducer.Multiply(e, w);
+		Integer u2 = reducer.Multiply(r, w);
 		// verify r == (g^u1 * y^u2 mod p) mod q
-		return r == params.ConvertElementToInteger(publicKey.CascadeExponentiateBaseAndPublicElement(u1, u2)) % q;
+		return r == reducer.Reduce(params.ConvertElementToInteger(publicKey.CascadeExponentiateBaseAndPublicElement(u1, u2)));
+	}
+
+	void VerifyBatch(const DL_GroupParameters<T> &params, const DL_PublicKey<T> &publicKey, size_t count, const Integer *e, const Integer *r, const Integer *s, bool *results) const
+	{
+		const BarrettReducer &reducer = params.GetSubgroupOrderReducer();
+		const Integer &q = params.GetSubgroupOrder();
+		std::vector<size_t> index;
+		std::vector<Integer> w;
+		index.reserve(count);
+		w.reserve(count);
+
+		for (size_t i=0; i<count; i++)
+		{
+			results[i] = false;
+			if (r[i]>=q || r[i]<1 || s[i]>=q || s[i]<1)
+				continue;
+			w.push_back(s[i]);
+			index.push_back(i);
+		}
+
+		if (index.empty())
+			return;
+
+		ModularArithmetic(q).SimultaneousInverse(&w[0], (unsigned int)w.size());
+		for (size_t j=0; j<index.size(); j++)
+		{
+			const size_t i = index[j];
+			Integer u1 = reducer.Multiply(e[i], w[j]);
+			Integer u2 = reducer.Multiply(r[i], w[j]);
+			results[i] = r[i] == reducer.Reduce(params.ConvertElementToInteger(publicKey.CascadeExponentiateBaseAndPublicElement(u1, u2)));
+		}
 	}
 };
 
@@ -188,9 +233,9 @@ public:
 
 	void Sign(const DL_GroupParameters<T> &params, const Integer &x, const Integer &k, const Integer &e, Integer &r, Integer &s) const
 	{
-		const Integer &q = params.GetSubgroupOrder();
-		r = (r + e) % q;
-		s = (k - x*r) % q;
+		const BarrettReducer &q = params.GetSubgroupOrderReducer();
+		r = q.Reduce(r + e);
+		s = q.Reduce(k - x*r);
 		assert(!!r);
 	}
 
@@ -201,7 +246,7 @@ public:
 			return false;
 
 		// check r == (m_g^s * m_y^r + m) mod m_q
-		return r == (params.ConvertElementToInteger(publicKey.CascadeExponentiateBaseAndPublicElement(s, r)) + e) % q;
+		return r == params.GetSubgroupOrderReducer().Reduce(params.ConvertElementToInteger(publicKey.CascadeExponentiateBaseAndPublicElement(s, r)) + e);
 	}
 };
 
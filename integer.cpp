@@ -15,8 +15,12 @@
 #include "pubkey.h"		// for P1363_KDF2
 #include "sha.h"
 #include "cpu.h"
+#include "trdlocal.h"
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdlib.h>
 
 #if _MSC_VER >= 1400
 	#include <intrin.h>
@@ -31,6 +35,8 @@
 #endif
 
 #define CRYPTOPP_INTEGER_SSE2 (CRYPTOPP_BOOL_SSE2_ASM_AVAILABLE && CRYPTOPP_BOOL_X86)
+#define CRYPTOPP_INTEGER_ADX (CRYPTOPP_BOOL_ADX_ASM_AVAILABLE && CRYPTOPP_BOOL_X64)
+#define CRYPTOPP_INTEGER_IFMA (CRYPTOPP_BOOL_AVX512IFMA_ASM_AVAILABLE && CRYPTOPP_BOOL_X64)
 
 NAMESPACE_BEGIN(CryptoPP)
 
@@ -836,6 +842,21 @@ static word LinearMultiply(word *C, const word *A, word B, size_t N)
 	return carry;
 }
 
+static word LinearMultiplyAccumulate(word *C, const word *A, word B, size_t N)
+{
+	word carry=0;
+	for(unsigned i=0; i<N; i++)
+	{
+		Declare2Words(p);
+		MultiplyWords(p, A[i], B);
+		Acc2WordsBy1(p, carry);
+		Acc2WordsBy1(p, C[i]);
+		C[i] = LowWord(p);
+		carry = HighWord(p);
+	}
+	return carry;
+}
+
 #ifndef CRYPTOPP_DOXYGEN_PROCESSING
 
 #define Mul_2 \
@@ -1936,6 +1957,83 @@ void SSE2_MultiplyTop32(word *C, const word *A, const word *B, word L)
 
 // ********************************************************
 
+#if CRYPTOPP_INTEGER_ADX
+
+// R[N] += A[N] * B, returns the carry word, N must be a positive multiple of 4.
+// MULX leaves the flags alone, so ADCX adds the low halves of the products on the carry flag
+// while ADOX adds the high halves on the overflow flag, and the loop is closed with LEA and
+// JRCXZ, which don't touch either flag.
+static inline word ADX_MultiplyAccumulate(word *R, const word *A, word B, size_t N)
+{
+	word lo, hi0, hi1, t;
+	size_t count = N/4;
+
+	__asm__ __volatile__
+	(
+		"xorl	%k[hi1], %k[hi1]\n\t"		// also clears CF and OF
+		"1:\n\t"
+		"mulxq	(%[A]), %[lo], %[hi0]\n\t"
+		"movq	(%[R]), %[t]\n\t"
+		"adcxq	%[lo], %[t]\n\t"
+		"adoxq	%[hi1], %[t]\n\t"
+		"movq	%[t], (%[R])\n\t"
+		"mulxq	8(%[A]), %[lo], %[hi1]\n\t"
+		"movq	8(%[R]), %[t]\n\t"
+		"adcxq	%[lo], %[t]\n\t"
+		"adoxq	%[hi0], %[t]\n\t"
+		"movq	%[t], 8(%[R])\n\t"
+		"mulxq	16(%[A]), %[lo], %[hi0]\n\t"
+		"movq	16(%[R]), %[t]\n\t"
+		"adcxq	%[lo], %[t]\n\t"
+		"adoxq	%[hi1], %[t]\n\t"
+		"movq	%[t], 16(%[R])\n\t"
+		"mulxq	24(%[A]), %[lo], %[hi1]\n\t"
+		"movq	24(%[R]), %[t]\n\t"
+		"adcxq	%[lo], %[t]\n\t"
+		"adoxq	%[hi0], %[t]\n\t"
+		"movq	%[t], 24(%[R])\n\t"
+		"leaq	32(%[A]), %[A]\n\t"
+		"leaq	32(%[R]), %[R]\n\t"
+		"leaq	-1(%[count]), %[count]\n\t"
+		"jrcxz	2f\n\t"
+		"jmp	1b\n\t"
+		"2:\n\t"
+		"movl	$0, %k[t]\n\t"
+		"adcxq	%[t], %[hi1]\n\t"
+		"adoxq	%[t], %[hi1]\n\t"
+		: [A] "+&r" (A), [R] "+&r" (R), [count] "+&c" (count), [lo] "=&r" (lo), [hi0] "=&r" (hi0), [hi1] "=&r" (hi1), [t] "=&r" (t)
+		: "d" (B)
+		: "cc", "memory"
+	);
+
+	return hi1;
+}
+
+// C[2*N] = A[N] * B[N], one row of partial products per word of B
+static inline void ADX_Multiply(word *C, const word *A, const word *B, size_t N)
+{
+	SetWords(C, 0, N);
+	for (size_t i=0; i<N; i++)
+		C[N+i] = ADX_MultiplyAccumulate(C+i, A, B[i], N);
+}
+
+void ADX_Multiply8(word *C, const word *A, const word *B)
+{
+	ADX_Multiply(C, A, B, 8);
+}
+
+void ADX_Multiply16(word *C, const word *A, const word *B)
+{
+	ADX_Multiply(C, A, B, 16);
+}
+
+void ADX_MontgomeryMultiply(word *R, word *T, const word *A, const word *B, const word *M, word u, size_t N);
+void ADX_MontgomeryReduce(word *R, word *X, const word *M, word u, size_t N);
+
+#endif	// #if CRYPTOPP_INTEGER_ADX
+
+// ********************************************************
+
 typedef int (CRYPTOPP_FASTCALL * PAdd)(size_t N, word *C, const word *A, const word *B);
 typedef void (* PMul)(word *C, const word *A, const word *B);
 typedef void (* PSqu)(word *C, const word *A);
@@ -1948,9 +2046,20 @@ static size_t s_recursionLimit = 8;
 static const size_t s_recursionLimit = 16;
 #endif
 
+typedef void (* PMontMul)(word *R, word *T, const word *A, const word *B, const word *M, word u, size_t N);
+typedef void (* PMontRed)(word *R, word *X, const word *M, word u, size_t N);
+
 static PMul s_pMul[9], s_pBot[9];
 static PSqu s_pSqu[9];
 static PMulTop s_pTop[9];
+static PMontMul s_pMontMul;
+static PMontRed s_pMontRed;
+
+// operand length in words from which RecursiveMultiply and RecursiveSquare switch from schoolbook
+// multiplication to Karatsuba, on top of s_recursionLimit, and to Toom-3, 0 for never;
+// atomic because the setters may run while other threads multiply
+static AtomicValue<size_t> s_karatsubaThreshold(0);
+static AtomicValue<size_t> s_toom3Threshold(CRYPTOPP_TOOM3_THRESHOLD);
 
 static void SetFunctionPointers()
 {
@@ -2013,6 +2122,18 @@ static void SetFunctionPointers()
 		s_pTop[4] = &Baseline_MultiplyTop16;
 #endif
 	}
+
+#if CRYPTOPP_INTEGER_ADX
+	if (HasBMI2() && HasADX())
+	{
+		// the 4-word baseline kernel is faster, and above 16 words Karatsuba on top of the 16-word kernel is
+		s_pMul[2] = &ADX_Multiply8;
+		s_pMul[4] = &ADX_Multiply16;
+
+		s_pMontMul = &ADX_MontgomeryMultiply;
+		s_pMontRed = &ADX_MontgomeryReduce;
+	}
+#endif
 }
 
 inline int Add(word *C, const word *A, const word *B, size_t N)
@@ -2051,6 +2172,30 @@ inline int Subtract(word *C, const word *A, const word *B, size_t N)
 #define R2		(R+N)
 #define R3		(R+N+N2)
 
+// R[2*N] - result = A*B
+// A[N] --- multiplier
+// B[N] --- multiplicant
+
+// used for the lengths left over by Toom-3 that have no fixed size kernel, and below s_karatsubaThreshold
+static void SchoolbookMultiply(word *R, const word *A, const word *B, size_t N)
+{
+#if CRYPTOPP_INTEGER_ADX
+	if (N%4 == 0 && HasBMI2() && HasADX())
+	{
+		SetWords(R, 0, N);
+		for (size_t i=0; i<N; i++)
+			R[N+i] = ADX_MultiplyAccumulate(R+i, A, B[i], N);
+		return;
+	}
+#endif
+
+	R[N] = LinearMultiply(R, A, B[0], N);
+	for (size_t i=1; i<N; i++)
+		R[N+i] = LinearMultiplyAccumulate(R+i, A, B[i], N);
+}
+
+static void Toom3Multiply(word *R, const word *A, const word *B, size_t N);
+
 // R[2*N] - result = A*B
 // T[2*N] - temporary work space
 // A[N] --- multiplier
@@ -2060,8 +2205,13 @@ void RecursiveMultiply(word *R, word *T, const word *A, const word *B, size_t N)
 {
 	assert(N>=2 && N%2==0);
 
-	if (N <= s_recursionLimit)
+	const size_t toom3Threshold = s_toom3Threshold.Load();
+	if (toom3Threshold && N >= toom3Threshold)
+		Toom3Multiply(R, A, B, N);
+	else if (N <= s_recursionLimit && IsPowerOf2(N))
 		s_pMul[N/4](R, A, B);
+	else if (N <= s_recursionLimit || N < s_karatsubaThreshold.Load() || N%4 != 0)
+		SchoolbookMultiply(R, A, B, N);
 	else
 	{
 		const size_t N2 = N/2;
@@ -2102,8 +2252,13 @@ void RecursiveSquare(word *R, word *T, const word *A, size_t N)
 {
 	assert(N && N%2==0);
 
-	if (N <= s_recursionLimit)
+	const size_t toom3Threshold = s_toom3Threshold.Load();
+	if (toom3Threshold && N >= toom3Threshold)
+		Toom3Multiply(R, A, A, N);
+	else if (N <= s_recursionLimit && IsPowerOf2(N))
 		s_pSqu[N/4](R, A);
+	else if (N <= s_recursionLimit || N < s_karatsubaThreshold.Load() || N%4 != 0)
+		SchoolbookMultiply(R, A, A, N);
 	else
 	{
 		const size_t N2 = N/2;
@@ -2196,6 +2351,193 @@ void MultiplyTop(word *R, word *T, const word *L, const word *A, const word *B,
 	}
 }
 
+// A[N] --- two's complement number divisible by 3, overwritten with the quotient
+
+static void DivideExactlyBy3(word *A, size_t N)
+{
+	const word third = (word(0)-1)/3, inverse = 2*third+1;
+	word c = 0;
+	for (size_t i=0; i<N; i++)
+	{
+		word s = A[i] - c;
+		word borrow = A[i] < c;
+		A[i] = s * inverse;
+		// c is the high word of 3*A[i], plus the borrow
+		c = (A[i] > third) + (A[i] > 2*third) + borrow;
+	}
+}
+
+// A[N] --- even two's complement number, overwritten with half of it
+
+static void HalveSigned(word *A, size_t N)
+{
+	word sign = A[N-1] & (word(1) << (WORD_BITS-1));
+	ShiftWordsRightByBits(A, N, 1);
+	A[N-1] |= sign;
+}
+
+// E1[k+2] --- X0+X1+X2
+// Em1[k+2] -- |X0-X1+X2|
+// Em2[k+2] -- |X0-2*X1+4*X2|
+// T[k+2] ---- temporary work space
+// X[3*k] ---- number to be evaluated, split into X0, X1 and X2
+// returns the signs of X0-X1+X2 in bit 0 and of X0-2*X1+4*X2 in bit 1
+
+static int Toom3Evaluate(word *E1, word *Em1, word *Em2, word *T, const word *X, size_t k)
+{
+	const word *X0 = X, *X1 = X+k, *X2 = X+2*k;
+	int signs = 0;
+
+	E1[k] = Add(E1, X0, X2, k);
+	E1[k+1] = 0;
+	if (Compare(E1, X1, k) < 0 && !E1[k])
+	{
+		Subtract(Em1, X1, E1, k);
+		Em1[k] = 0;
+		signs |= 1;
+	}
+	else
+		Em1[k] = E1[k] - Subtract(Em1, E1, X1, k);
+	Em1[k+1] = 0;
+	E1[k] += Add(E1, E1, X1, k);
+
+	CopyWords(Em2, X2, k);
+	Em2[k] = ShiftWordsLeftByBits(Em2, k, 2);
+	Em2[k] += Add(Em2, Em2, X0, k);
+	Em2[k+1] = 0;
+	CopyWords(T, X1, k);
+	T[k] = ShiftWordsLeftByBits(T, k, 1);
+	T[k+1] = 0;
+	if (Compare(Em2, T, k+2) < 0)
+	{
+		Subtract(Em2, T, Em2, k+2);
+		signs |= 2;
+	}
+	else
+		Subtract(Em2, Em2, T, k+2);
+
+	return signs;
+}
+
+// P[2*k+2] - result = U*V
+// T[2*k] --- temporary work space
+// U[k+2] --- multiplier, whose word k is small and word k+1 is zero
+// V[k+2] --- multiplicant, likewise, or the same as U to square
+
+static void Toom3MultiplyPoint(word *P, word *T, const word *U, const word *V, size_t k)
+{
+	if (U == V)
+		RecursiveSquare(P, T, U, k);
+	else
+		RecursiveMultiply(P, T, U, V, k);
+	P[2*k] = P[2*k+1] = 0;
+
+	// add the products involving the small top words
+	if (U[k])
+	{
+		T[k] = LinearMultiply(T, V, U[k], k);
+		T[k+1] = 0;
+		Add(P+k, P+k, T, k+2);
+	}
+	if (V[k])
+	{
+		T[k] = LinearMultiply(T, U, V[k], k);
+		T[k+1] = 0;
+		Add(P+k, P+k, T, k+2);
+	}
+	P[2*k] += U[k]*V[k];
+}
+
+// R[2*N] - result = A*B
+// A[N] --- multiplier
+// B[N] --- multiplicant, or the same as A to square
+
+// Evaluates at 0, 1, -1, -2 and infinity, and interpolates with Bodrato's sequence.
+// N is normally a power of 2, so the pieces aren't, and the lengths Karatsuba halves them down to
+// end in SchoolbookMultiply instead of the fixed size kernels.
+
+static void Toom3Multiply(word *R, const word *A, const word *B, size_t N)
+{
+	// round the pieces up so that Karatsuba halves them down to a multiple of 4 words within the recursion limit
+	size_t k = (N+2)/3, shift = 0;
+	while (((k-1) >> shift) >= s_recursionLimit)
+		shift++;
+	k = ((((k-1) >> shift) + 4) & ~size_t(3)) << shift;
+	const size_t L = 2*k+2;
+	const bool square = (A == B);
+
+	IntegerSecBlock space(6*k + 6*(k+2) + 5*L + 6*k + 2*k + k+2);
+	word *XA = space, *XB = XA+3*k;
+	word *EA1 = XB+3*k, *EAm1 = EA1+k+2, *EAm2 = EAm1+k+2;
+	word *EB1 = EAm2+k+2, *EBm1 = EB1+k+2, *EBm2 = EBm1+k+2;
+	word *W0 = EBm2+k+2, *W1 = W0+L, *Wm1 = W1+L, *Wm2 = Wm1+L, *Winf = Wm2+L;
+	word *O = Winf+L, *T = O+6*k;
+
+	CopyWords(XA, A, N);
+	SetWords(XA+N, 0, 3*k-N);
+	int signs = Toom3Evaluate(EA1, EAm1, EAm2, T, XA, k);
+	if (square)
+	{
+		XB = XA;
+		EB1 = EA1; EBm1 = EAm1; EBm2 = EAm2;
+		signs = 0;
+	}
+	else
+	{
+		CopyWords(XB, B, N);
+		SetWords(XB+N, 0, 3*k-N);
+		signs ^= Toom3Evaluate(EB1, EBm1, EBm2, T, XB, k);
+	}
+
+	if (square)
+	{
+		RecursiveSquare(W0, T, XA, k);
+		RecursiveSquare(Winf, T, XA+2*k, k);
+	}
+	else
+	{
+		RecursiveMultiply(W0, T, XA, XB, k);
+		RecursiveMultiply(Winf, T, XA+2*k, XB+2*k, k);
+	}
+	W0[2*k] = W0[2*k+1] = Winf[2*k] = Winf[2*k+1] = 0;
+	Toom3MultiplyPoint(W1, T, EA1, EB1, k);
+	Toom3MultiplyPoint(Wm1, T, EAm1, EBm1, k);
+	if (signs & 1)
+		TwosComplement(Wm1, L);
+	Toom3MultiplyPoint(Wm2, T, EAm2, EBm2, k);
+	if (signs & 2)
+		TwosComplement(Wm2, L);
+
+	// now W0, W1, Wm1, Wm2 and Winf hold the product evaluated at 0, 1, -1, -2 and infinity
+
+	Subtract(Wm2, Wm2, W1, L);
+	DivideExactlyBy3(Wm2, L);
+	Subtract(W1, W1, Wm1, L);
+	HalveSigned(W1, L);
+	Subtract(Wm1, Wm1, W0, L);
+	Subtract(Wm2, Wm1, Wm2, L);
+	HalveSigned(Wm2, L);
+	Add(Wm2, Wm2, Winf, L);
+	Add(Wm2, Wm2, Winf, L);
+	Add(Wm1, Wm1, W1, L);
+	Subtract(Wm1, Wm1, Winf, L);
+	Subtract(W1, W1, Wm2, L);
+
+	// now W1, Wm1 and Wm2 hold the coefficients of x, x**2 and x**3, where x = 2**(WORD_BITS*k)
+
+	CopyWords(O, W0, 2*k);
+	SetWords(O+2*k, 0, 2*k);
+	CopyWords(O+4*k, Winf, 2*k);
+	if (Add(O+k, O+k, W1, L))
+		Increment(O+k+L, 3*k-2);
+	if (Add(O+2*k, O+2*k, Wm1, L))
+		Increment(O+2*k+L, 2*k-2);
+	if (Add(O+3*k, O+3*k, Wm2, L))
+		Increment(O+3*k+L, k-2);
+
+	CopyWords(R, O, 2*N);
+}
+
 inline void Multiply(word *R, word *T, const word *A, const word *B, size_t N)
 {
 	RecursiveMultiply(R, T, A, B, N);
@@ -2314,6 +2656,12 @@ void RecursiveInverseModPower2(word *R, word *T, const word *A, size_t N)
 
 void MontgomeryReduce(word *R, word *T, word *X, const word *M, const word *U, size_t N)
 {
+	if (s_pMontRed && N%4 == 0)
+	{
+		s_pMontRed(R, X, M, 0-U[0], N);
+		return;
+	}
+
 #if 1
 	MultiplyBottom(R, T, X, U, N);
 	MultiplyTop(T, T+N, X, R, M, N);
@@ -2378,6 +2726,136 @@ void MontgomeryReduce(word *R, word *T, word *X, const word *M, const word *U, s
 #endif
 }
 
+#if CRYPTOPP_INTEGER_ADX
+
+#define ADX_MONT4_ROW(i, t0, t1, t2, t3, t4, t5)	\
+	"xorl	%k[lo], %k[lo]\n\t"	\
+	"movq	" #i "*8(%[B]), %%rdx\n\t"	\
+	"mulxq	(%[A]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t0 "]\n\t"	\
+	"adoxq	%[hi], %[" #t1 "]\n\t"	\
+	"mulxq	8(%[A]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t1 "]\n\t"	\
+	"adoxq	%[hi], %[" #t2 "]\n\t"	\
+	"mulxq	16(%[A]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t2 "]\n\t"	\
+	"adoxq	%[hi], %[" #t3 "]\n\t"	\
+	"mulxq	24(%[A]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t3 "]\n\t"	\
+	"adoxq	%[hi], %[" #t4 "]\n\t"	\
+	"adcxq	%[zero], %[" #t4 "]\n\t"	\
+	"adoxq	%[zero], %[" #t5 "]\n\t"	\
+	"adcxq	%[zero], %[" #t5 "]\n\t"	\
+	"movq	%[u], %%rdx\n\t"	\
+	"imulq	%[" #t0 "], %%rdx\n\t"	\
+	"xorl	%k[lo], %k[lo]\n\t"	\
+	"mulxq	(%[M]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t0 "]\n\t"	\
+	"adoxq	%[hi], %[" #t1 "]\n\t"	\
+	"mulxq	8(%[M]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t1 "]\n\t"	\
+	"adoxq	%[hi], %[" #t2 "]\n\t"	\
+	"mulxq	16(%[M]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t2 "]\n\t"	\
+	"adoxq	%[hi], %[" #t3 "]\n\t"	\
+	"mulxq	24(%[M]), %[lo], %[hi]\n\t"	\
+	"adcxq	%[lo], %[" #t3 "]\n\t"	\
+	"adoxq	%[hi], %[" #t4 "]\n\t"	\
+	"adcxq	%[zero], %[" #t4 "]\n\t"	\
+	"adoxq	%[zero], %[" #t5 "]\n\t"	\
+	"adcxq	%[zero], %[" #t5 "]\n\t"
+
+// R[4] --- result = A*B/(2**(WORD_BITS*4)) mod M
+// T[8] --- temporary work space
+// A[4] --- multiplier, less than M
+// B[4] --- multiplicant, less than M
+// M[4] --- modulus
+// u ------ -1/M mod 2**WORD_BITS
+
+// The same CIOS as ADX_MontgomeryMultiply, with the running sum kept in six registers whose
+// roles rotate by one word per row, since the reduction always leaves its lowest word zero.
+static void ADX_MontgomeryMultiply4(word *R, word *T, const word *A, const word *B, const word *M, word u)
+{
+	word r0=0, r1=0, r2=0, r3=0, r4=0, r5=0, lo, hi;
+	const word zero = 0;
+
+	__asm__ __volatile__
+	(
+		ADX_MONT4_ROW(0, r0, r1, r2, r3, r4, r5)
+		ADX_MONT4_ROW(1, r1, r2, r3, r4, r5, r0)
+		ADX_MONT4_ROW(2, r2, r3, r4, r5, r0, r1)
+		ADX_MONT4_ROW(3, r3, r4, r5, r0, r1, r2)
+		: [r0] "+&r" (r0), [r1] "+&r" (r1), [r2] "+&r" (r2), [r3] "+&r" (r3), [r4] "+&r" (r4), [r5] "+&r" (r5), [lo] "=&r" (lo), [hi] "=&r" (hi)
+		: [A] "r" (A), [B] "r" (B), [M] "r" (M), [u] "m" (u), [zero] "m" (zero)
+		: "rdx", "cc", "memory"
+	);
+
+	// now r4, r5, r0, r1 hold the sum, less than 2*M, and r2 its carry word
+	T[4] = r4; T[5] = r5; T[6] = r0; T[7] = r1;
+
+	// defend against timing attack by doing this Subtract even when not needed
+	word borrow = Subtract(T, T+4, M, 4);
+	CopyWords(R, T + ((0-(borrow-r2)) & 4), 4);
+}
+
+// R[N] --- result = A*B/(2**(WORD_BITS*N)) mod M
+// T[2*N+1] - temporary work space
+// A[N] --- multiplier, less than M
+// B[N] --- multiplicant, less than M
+// M[N] --- modulus
+// u ------ -1/M mod 2**WORD_BITS
+
+void ADX_MontgomeryMultiply(word *R, word *T, const word *A, const word *B, const word *M, word u, size_t N)
+{
+	if (N == 4)
+	{
+		ADX_MontgomeryMultiply4(R, T, A, B, M, u);
+		return;
+	}
+
+	// each iteration adds A*B[i] to T, then cancels its lowest word with a multiple of M,
+	// so T[i+1..i+N] plus T[i+N+1] stay less than 2*M
+	SetWords(T, 0, 2*N+1);
+	for (size_t i=0; i<N; i++)
+	{
+		word c = ADX_MultiplyAccumulate(T+i, A, B[i], N);
+		T[i+N] += c;
+		T[i+N+1] = T[i+N] < c;
+		c = ADX_MultiplyAccumulate(T+i, M, T[i]*u, N);
+		T[i+N] += c;
+		T[i+N+1] += T[i+N] < c;
+	}
+
+	// defend against timing attack by doing this Subtract even when not needed
+	word borrow = Subtract(T, T+N, M, N);
+	CopyWords(R, T + ((0-(borrow-T[2*N])) & N), N);
+}
+
+// R[N] --- result = X/(2**(WORD_BITS*N)) mod M
+// X[2*N] - number to be reduced, less than M*2**(WORD_BITS*N), overwritten
+// M[N] --- modulus
+// u ------ -1/M mod 2**WORD_BITS
+
+void ADX_MontgomeryReduce(word *R, word *X, const word *M, word u, size_t N)
+{
+	word carry = 0;
+	for (size_t i=0; i<N; i++)
+	{
+		// cancel X[i], then add the carry out of that row and the one left over from the previous row to X[i+N]
+		word c = ADX_MultiplyAccumulate(X+i, M, X[i]*u, N);
+		X[i+N] += carry;
+		carry = X[i+N] < carry;
+		X[i+N] += c;
+		carry += X[i+N] < c;
+	}
+
+	// defend against timing attack by doing this Subtract even when not needed
+	word borrow = Subtract(X, X+N, M, N);
+	CopyWords(R, X + ((0-(borrow-carry)) & N), N);
+}
+
+#endif
+
 // R[N] --- result = X/(2**(WORD_BITS*N/2)) mod M
 // T[2*N] - temporary work space
 // X[2*N] - number to be reduced
@@ -2611,89 +3089,6 @@ void Divide(word *R, word *Q, word *T, const word *A, size_t NA, const word *B,
 	ShiftWordsRightByBits(R, NB, shiftBits);
 }
 
-static inline size_t EvenWordCount(const word *X, size_t N)
-{
-	while (N && X[N-2]==0 && X[N-1]==0)
-		N-=2;
-	return N;
-}
-
-// return k
-// R[N] --- result = A^(-1) * 2^k mod M
-// T[4*N] - temporary work space
-// A[NA] -- number to take inverse of
-// M[N] --- modulus
-
-unsigned int AlmostInverse(word *R, word *T, const word *A, size_t NA, const word *M, size_t N)
-{
-	assert(NA<=N && N && N%2==0);
-
-	word *b = T;
-	word *c = T+N;
-	word *f = T+2*N;
-	word *g = T+3*N;
-	size_t bcLen=2, fgLen=EvenWordCount(M, N);
-	unsigned int k=0;
-	bool s=false;
-
-	SetWords(T, 0, 3*N);
-	b[0]=1;
-	CopyWords(f, A, NA);
-	CopyWords(g, M, N);
-
-	while (1)
-	{
-		word t=f[0];
-		while (!t)
-		{
-			if (EvenWordCount(f, fgLen)==0)
-			{
-				SetWords(R, 0, N);
-				return 0;
-			}
-
-			ShiftWordsRightByWords(f, fgLen, 1);
-			bcLen += 2 * (c[bcLen-1] != 0);
-			assert(bcLen <= N);
-			ShiftWordsLeftByWords(c, bcLen, 1);
-			k+=WORD_BITS;
-			t=f[0];
-		}
-
-		unsigned int i = TrailingZeros(t);
-		t >>= i;
-		k += i;
-
-		if (t==1 && f[1]==0 && EvenWordCount(f+2, fgLen-2)==0)
-		{
-			if (s)
-				Subtract(R, M, b, N);
-			else
-				CopyWords(R, b, N);
-			return k;
-		}
-
-		ShiftWordsRightByBits(f, fgLen, i);
-		t = ShiftWordsLeftByBits(c, bcLen, i);
-		c[bcLen] += t;
-		bcLen += 2 * (t!=0);
-		assert(bcLen <= N);
-
-		bool swap = Compare(f, g, fgLen)==-1;
-		ConditionalSwapPointers(swap, f, g);
-		ConditionalSwapPointers(swap, b, c);
-		s ^= swap;
-
-		fgLen -= 2 * !(f[fgLen-2] | f[fgLen-1]);
-
-		Subtract(f, f, g, fgLen);
-		t = Add(b, b, c, bcLen);
-		b[bcLen] += t;
-		bcLen += 2*t;
-		assert(bcLen <= N);
-	}
-}
-
 // R[N] - result = A/(2^k) mod M
 // A[N] - input
 // M[N] - modulus
@@ -2715,19 +3110,6 @@ void DivideByPower2Mod(word *R, const word *A, size_t k, const word *M, size_t N
 	}
 }
 
-// R[N] - result = A*(2^k) mod M
-// A[N] - input
-// M[N] - modulus
-
-void MultiplyByPower2Mod(word *R, const word *A, size_t k, const word *M, size_t N)
-{
-	CopyWords(R, A, N);
-
-	while (k--)
-		if (ShiftWordsLeftByBits(R, N, 1) || Compare(R, M, N)>=0)
-			Subtract(R, R, M, N);
-}
-
 // ******************************************************************
 
 InitializeInteger::InitializeInteger()
@@ -2736,6 +3118,20 @@ InitializeInteger::InitializeInteger()
 	{
 		SetFunctionPointers();
 		g_pAssignIntToInteger = AssignIntToInteger;
+
+		const char *tuningFile = getenv("CRYPTOPP_INTEGER_TUNING");
+		if (tuningFile)
+		{
+			std::ifstream in(tuningFile);
+			try
+			{
+				if (in)
+					Integer::LoadTuning(in);
+			}
+			catch (const Exception &)
+			{
+			}
+		}
 	}
 }
 
@@ -3950,34 +4346,435 @@ Integer a_exp_b_mod_c(const Integer &x, const Integer& e, const Integer& m)
 	return mr.Exponentiate(x, e);
 }
 
-Integer Integer::Gcd(const Integer &a, const Integer &b)
+#if CRYPTOPP_INTEGER_IFMA
+
+// Eight modular exponentiations with a common odd modulus and exponent run together, one in each
+// 64-bit lane of a ZMM register. Numbers are held in n limbs of 52 bits, with limb j of all eight
+// numbers in the eight words starting at j*8. VPMADD52LUQ and VPMADD52HUQ add the low and high 52
+// bits of a 52x52-bit product to a 64-bit lane, so partial sums can grow past 52 bits and carries
+// are only propagated at the end of each multiplication.
+
+#define IFMA_LANES 8
+#define IFMA_LIMB_BITS 52
+#define IFMA_LIMB_MASK ((W64LIT(1) << IFMA_LIMB_BITS) - 1)
+#define IFMA_TARGET __attribute__((target("avx512f,avx512ifma")))
+
+typedef word64 IFMA_Vector __attribute__((vector_size(64)));
+
+// t + the low 52 bits of a*b in each lane
+IFMA_TARGET static inline IFMA_Vector IFMA_MulAddLow(IFMA_Vector t, IFMA_Vector a, IFMA_Vector b)
 {
-	return EuclideanDomainOf<Integer>().Gcd(a, b);
+	asm ("vpmadd52luq %2, %1, %0" : "+v" (t) : "v" (a), "v" (b));
+	return t;
 }
 
-Integer Integer::InverseMod(const Integer &m) const
+// t + bits 52 to 103 of a*b in each lane
+IFMA_TARGET static inline IFMA_Vector IFMA_MulAddHigh(IFMA_Vector t, IFMA_Vector a, IFMA_Vector b)
 {
-	assert(m.NotNegative());
+	asm ("vpmadd52huq %2, %1, %0" : "+v" (t) : "v" (a), "v" (b));
+	return t;
+}
 
-	if (IsNegative())
-		return Modulo(m).InverseMod(m);
+// R = A * B / 2^(52*n) mod M, almost: if A and B are less than 2*M and 4*M < 2^(52*n), so is R.
+// M holds each limb of the modulus broadcast to all lanes, k0 = -M^-1 mod 2^52, and T must have
+// room for 2*n+1 vectors. R may overlap A or B.
+IFMA_TARGET static void IFMA_MontgomeryMultiply(word64 *R, const word64 *A, const word64 *B, const word64 *M, word64 k0, word64 *T, size_t n)
+{
+	const IFMA_Vector zero = {0}, k = zero + k0;
+	IFMA_Vector *t = (IFMA_Vector *)T;
+	const IFMA_Vector *a = (const IFMA_Vector *)A, *b = (const IFMA_Vector *)B, *m = (const IFMA_Vector *)M;
+	size_t i, j;
 
-	if (m.IsEven())
+	for (i=0; i<=2*n; i++)
+		t[i] = zero;
+
+	for (i=0; i<n; i++)
 	{
-		if (!m || IsEven())
-			return Zero();	// no inverse
-		if (*this == One())
-			return One();
+		// T[i] is a multiple of 2^52 once y*M is added, and its carry moves up to T[i+1]
+		const IFMA_Vector ai = a[i];
+		IFMA_Vector t0 = IFMA_MulAddLow(t[i], ai, b[0]);
+		const IFMA_Vector y = IFMA_MulAddLow(zero, t0, k);
+		t0 = IFMA_MulAddLow(t0, y, m[0]);
+		IFMA_Vector *u = t+i;
+
+		for (j=1; j<n; j++)
+		{
+			IFMA_Vector v = IFMA_MulAddLow(u[j], ai, b[j]);
+			v = IFMA_MulAddLow(v, y, m[j]);
+			v = IFMA_MulAddHigh(v, ai, b[j-1]);
+			u[j] = IFMA_MulAddHigh(v, y, m[j-1]);
+		}
+		u[n] = IFMA_MulAddHigh(IFMA_MulAddHigh(u[n], ai, b[n-1]), y, m[n-1]);
+		u[1] += t0 >> IFMA_LIMB_BITS;
+	}
 
-		Integer u = m.Modulo(*this).InverseMod(*this);
-		return !u ? Zero() : (m*(*this-u)+1)/(*this);
+	IFMA_Vector carry = zero;
+	for (j=0; j<n; j++)
+	{
+		const IFMA_Vector v = t[n+j] + carry;
+		carry = v >> IFMA_LIMB_BITS;
+		((IFMA_Vector *)R)[j] = v & IFMA_LIMB_MASK;
 	}
+}
 
-	SecBlock<word> T(m.reg.size() * 4);
-	Integer r((word)0, m.reg.size());
-	unsigned k = AlmostInverse(r.reg, T, reg, reg.size(), m.reg, m.reg.size());
-	DivideByPower2Mod(r.reg, r.reg, k, m.reg, m.reg.size());
-	return r;
+// returns bits 52*j to 52*j+51 of the number in w[words]
+static inline word64 IFMA_GetLimb(const word *w, size_t words, size_t j)
+{
+	const size_t bit = j*IFMA_LIMB_BITS, k = bit/WORD_BITS, shift = bit%WORD_BITS;
+	if (k >= words)
+		return 0;
+	word64 v = w[k] >> shift;
+	if (shift > WORD_BITS-IFMA_LIMB_BITS && k+1 < words)
+		v |= w[k+1] << (WORD_BITS-shift);
+	return v & IFMA_LIMB_MASK;
+}
+
+// X = X^e / 2^(52*n*(e-1)) mod M, almost: the result is less than 2*M if X is.
+// e is public, so the sequence of squarings and multiplications doesn't need to be hidden.
+static void IFMA_Exponentiate(word64 *X, const Integer &e, const word64 *M, word64 k0, word64 *T, size_t n)
+{
+	word64 *R = T + (2*n+1)*IFMA_LANES;
+	memcpy(R, X, n*IFMA_LANES*sizeof(word64));
+	for (size_t i=e.BitCount()-1; i>0; i--)
+	{
+		IFMA_MontgomeryMultiply(R, R, R, M, k0, T, n);
+		if (e.GetBit(i-1))
+			IFMA_MontgomeryMultiply(R, R, X, M, k0, T, n);
+	}
+	memcpy(X, R, n*IFMA_LANES*sizeof(word64));
+}
+
+#endif	// #if CRYPTOPP_INTEGER_IFMA
+
+void a_exp_b_mod_c(Integer *results, const Integer *x, size_t count, const Integer &e, const Integer &m)
+{
+#if CRYPTOPP_INTEGER_IFMA
+	// a lone exponentiation is faster with the word-at-a-time kernels
+	if (count > 1 && m.IsOdd() && e.IsPositive() && HasAVX512IFMA())
+	{
+		const size_t n = (m.BitCount() + 2 + IFMA_LIMB_BITS - 1) / IFMA_LIMB_BITS;	// so that 4*m < 2^(52*n)
+		const size_t mWords = m.WordCount();
+		const size_t vectorWords = n*IFMA_LANES;
+
+		// X, one and the broadcast modulus and R^2 mod m, then the multiplication and exponentiation workspace
+		SecBlock<word64> buffer(7*vectorWords + 2*IFMA_LANES);
+		word64 *X = buffer + ((0 - (size_t)buffer.data()/sizeof(word64)) & (IFMA_LANES-1));
+		word64 *one = X + vectorWords, *M = one + vectorWords, *R2 = M + vectorWords, *T = R2 + vectorWords;
+
+		Integer r2 = Integer::Power2(2*IFMA_LIMB_BITS*n) % m;
+		word64 k0 = 1;
+		for (unsigned int i=0; i<6; i++)	// Newton iteration doubles the number of correct bits
+			k0 *= 2 - m.reg[0]*k0;
+		k0 = (0-k0) & IFMA_LIMB_MASK;
+
+		memset(one, 0, vectorWords*sizeof(word64));
+		for (size_t j=0; j<n; j++)
+		{
+			word64 mj = IFMA_GetLimb(m.reg, mWords, j), rj = IFMA_GetLimb(r2.reg, r2.WordCount(), j);
+			for (unsigned int l=0; l<IFMA_LANES; l++)
+			{
+				M[j*IFMA_LANES+l] = mj;
+				R2[j*IFMA_LANES+l] = rj;
+			}
+		}
+		for (unsigned int l=0; l<IFMA_LANES; l++)
+			one[l] = 1;
+
+		for (size_t first=0; first<count; first+=IFMA_LANES)
+		{
+			const unsigned int lanes = (unsigned int)STDMIN(count-first, size_t(IFMA_LANES));
+			memset(X, 0, vectorWords*sizeof(word64));
+			for (unsigned int l=0; l<lanes; l++)
+			{
+				Integer reduced;
+				const Integer *xl = x+first+l;
+				if (xl->IsNegative() || *xl >= m)
+					xl = &(reduced = *xl % m);
+				for (size_t j=0; j<n; j++)
+					X[j*IFMA_LANES+l] = IFMA_GetLimb(xl->reg, xl->WordCount(), j);
+			}
+
+			// into Montgomery form, exponentiate, and out again, which leaves each lane at most m
+			IFMA_MontgomeryMultiply(X, X, R2, M, k0, T, n);
+			IFMA_Exponentiate(X, e, M, k0, T, n);
+			IFMA_MontgomeryMultiply(X, X, one, M, k0, T, n);
+
+			for (unsigned int l=0; l<lanes; l++)
+			{
+				Integer &r = results[first+l];
+				r.reg.CleanNew(RoundupSize(mWords));
+				r.sign = Integer::POSITIVE;
+				for (size_t j=0; j<n; j++)
+				{
+					size_t bit = j*IFMA_LIMB_BITS, k = bit/WORD_BITS, shift = bit%WORD_BITS;
+					word64 v = X[j*IFMA_LANES+l];
+					if (k < mWords)
+						r.reg[k] |= v << shift;
+					if (shift > WORD_BITS-IFMA_LIMB_BITS && k+1 < mWords)
+						r.reg[k+1] |= v >> (WORD_BITS-shift);
+				}
+				if (r >= m)
+					r -= m;
+			}
+		}
+		return;
+	}
+#endif
+
+	if (m.IsOdd())
+	{
+		// one Montgomery representation for the whole batch
+		MontgomeryRepresentation mr(m);
+		for (size_t i=0; i<count; i++)
+			results[i] = mr.ConvertOut(mr.Exponentiate(mr.ConvertIn(x[i]), e));
+		return;
+	}
+
+	ModularArithmetic mr(m);
+	for (size_t i=0; i<count; i++)
+		results[i] = mr.Exponentiate(x[i], e);
+}
+
+// ********************************************************
+
+// Lehmer's algorithm runs the Euclidean algorithm on the leading digits of two numbers for as long as
+// the quotients are certain to be theirs, and then applies all those quotients to the full numbers
+// in one linear pass. With double-word leading digits, each pass takes about a word off both numbers.
+
+#ifdef CRYPTOPP_NATIVE_DWORD_AVAILABLE
+typedef dword LehmerDigits;
+#define LEHMER_DIGIT_BITS (2*WORD_BITS)
+#define LEHMER_COFACTOR_BITS WORD_BITS
+#else
+typedef word LehmerDigits;
+#define LEHMER_DIGIT_BITS WORD_BITS
+#define LEHMER_COFACTOR_BITS (WORD_BITS/2)
+#endif
+
+// returns bits s to s+WORD_BITS-1 of A[N]
+static inline word GetWordAtBit(const word *A, size_t N, size_t s)
+{
+	const size_t k = s/WORD_BITS, shift = s%WORD_BITS;
+	word w = k < N ? A[k] >> shift : 0;
+	if (shift && k+1 < N)
+		w |= A[k+1] << (WORD_BITS-shift);
+	return w;
+}
+
+// returns bits s to s+LEHMER_DIGIT_BITS-1 of A[N]
+static inline LehmerDigits GetLeadingDigits(const word *A, size_t N, size_t s)
+{
+#ifdef CRYPTOPP_NATIVE_DWORD_AVAILABLE
+	return ((dword)GetWordAtBit(A, N, s+WORD_BITS) << WORD_BITS) | GetWordAtBit(A, N, s);
+#else
+	return GetWordAtBit(A, N, s);
+#endif
+}
+
+// Runs the Euclidean algorithm on a >= b, the bits of A >= B from the same bit s up, for as long as
+// the quotients are certain to be those of A and B, and returns how many were taken, k. The next two
+// remainders of A and B are then (-1)^k * (x0*A - y0*B) and (-1)^(k+1) * (x1*A - y1*B).
+// exact means s is 0, so a and b are A and B.
+static unsigned int LehmerCofactors(LehmerDigits a, LehmerDigits b, bool exact, word &x0, word &y0, word &x1, word &y1)
+{
+	const LehmerDigits limit = LehmerDigits(1) << LEHMER_COFACTOR_BITS;
+	LehmerDigits u0 = 1, v0 = 0, u1 = 0, v1 = 1;
+	unsigned int k = 0;
+
+	while (b)
+	{
+		LehmerDigits q = 1, r = a - b;
+		if (r >= b)
+		{
+			q = a / b;
+			r = a - q*b;
+		}
+		if (q >= limit)
+			break;
+
+		LehmerDigits u2 = u0 + q*u1, v2 = v0 + q*v1;
+		if (u2 >= limit || v2 >= limit)
+			break;
+
+		// The bits below s move the remainder of A and B away from r * 2^s by less than
+		// max(u2, v2) * 2^s, so these make sure it stays nonnegative and below the previous one.
+		if (!exact && (r < STDMAX(u2, v2) || b - r < STDMAX(u1+u2, v1+v2)))
+			break;
+
+		a = b; b = r;
+		u0 = u1; u1 = u2;
+		v0 = v1; v1 = v2;
+		k++;
+	}
+
+	x0 = (word)u0; y0 = (word)v0;
+	x1 = (word)u1; y1 = (word)v1;
+	return k;
+}
+
+// C[N] = x*A[N] - y*B[N], returns the word above C, which is 0 if the difference is nonnegative and fits in N words
+static word LinearCombinationDifference(word *C, const word *A, word x, const word *B, word y, size_t N)
+{
+	word ca = 0, cb = 0, borrow = 0;
+	for (size_t i=0; i<N; i++)
+	{
+		DWord pa = DWord::MultiplyAndAdd(A[i], x, ca), pb = DWord::MultiplyAndAdd(B[i], y, cb);
+		word la = pa.GetLowHalf(), lb = pb.GetLowHalf(), d = la - lb;
+		C[i] = d - borrow;
+		borrow = (la < lb) + (d < borrow);
+		ca = pa.GetHighHalf();
+		cb = pb.GetHighHalf();
+	}
+	return ca - cb - borrow;
+}
+
+// C[N] = x*A[N] + y*B[N], returns the carry
+static word LinearCombinationSum(word *C, const word *A, word x, const word *B, word y, size_t N)
+{
+	word ca = 0, cb = 0, carry = 0;
+	for (size_t i=0; i<N; i++)
+	{
+		DWord pa = DWord::MultiplyAndAdd(A[i], x, ca), pb = DWord::MultiplyAndAdd(B[i], y, cb);
+		word la = pa.GetLowHalf(), s = la + pb.GetLowHalf();
+		C[i] = s + carry;
+		carry = (s < la) + (C[i] < s);
+		ca = pa.GetHighHalf();
+		cb = pb.GetHighHalf();
+	}
+	return ca + cb + carry;
+}
+
+// Replaces r0 >= r1 >= 0 by gcd(r0, r1) and 0, and returns whether the Euclidean algorithm took an odd
+// number of steps. If y is not NULL, it is set to the cofactor of r1 that goes with the gcd, so that
+// gcd = (-1)^(odd+1) * y * r1 mod r0, using the values of r0 and r1 on entry.
+bool LehmerEuclid(Integer &r0, Integer &r1, Integer *y)
+{
+	assert(r1.NotNegative() && r1 <= r0);
+
+	const size_t N = STDMAX(r0.WordCount(), 1U);
+	SecBlock<word> buffer(4*N + (y ? 4*(N+2) : 0));
+	SetWords(buffer, 0, buffer.size());
+	word *R0 = buffer, *R1 = R0+N, *T0 = R1+N, *T1 = T0+N;
+	word *Y0 = T1+N, *Y1 = Y0+N+2, *U0 = Y1+N+2, *U1 = U0+N+2;
+	size_t n = N, ny = 1;
+	bool odd = false;
+
+	CopyWords(R0, r0.reg, N);
+	CopyWords(R1, r1.reg, STDMIN(N, r1.reg.size()));
+	if (y)
+		Y1[0] = 1;
+
+	while (true)
+	{
+		while (n && !R0[n-1])
+			n--;
+		if (!CountWords(R1, n))
+			break;
+
+		const size_t bits = (n-1)*WORD_BITS + BitPrecision(R0[n-1]);
+		const size_t s = bits > LEHMER_DIGIT_BITS ? bits - LEHMER_DIGIT_BITS : 0;
+		word x0, y0, x1, y1;
+		const unsigned int k = LehmerCofactors(GetLeadingDigits(R0, n, s), GetLeadingDigits(R1, n, s), s == 0, x0, y0, x1, y1);
+
+		if (k == 0)
+		{
+			// the next quotient doesn't fit in a cofactor, so take it with a full division
+			Integer a, b, q, r;
+			a.reg.CleanNew(RoundupSize(n));
+			CopyWords(a.reg, R0, n);
+			b.reg.CleanNew(RoundupSize(n));
+			CopyWords(b.reg, R1, n);
+			Integer::Divide(r, q, a, b);
+			CopyWords(R0, R1, n);
+			SetWords(R1, 0, n);
+			CopyWords(R1, r.reg, r.WordCount());
+
+			if (y)
+			{
+				a.reg.CleanNew(RoundupSize(ny));
+				CopyWords(a.reg, Y0, ny);
+				b.reg.CleanNew(RoundupSize(ny));
+				CopyWords(b.reg, Y1, ny);
+				a += q*b;
+				assert(a.WordCount() <= N);
+				ny = STDMAX(ny, (size_t)a.WordCount());
+				CopyWords(Y0, Y1, ny);
+				SetWords(Y1, 0, N+2);
+				CopyWords(Y1, a.reg, a.WordCount());
+			}
+
+			odd = !odd;
+			continue;
+		}
+
+		word top0, top1;
+		if (k%2 == 0)
+		{
+			top0 = LinearCombinationDifference(T0, R0, x0, R1, y0, n);
+			top1 = LinearCombinationDifference(T1, R1, y1, R0, x1, n);
+		}
+		else
+		{
+			top0 = LinearCombinationDifference(T0, R1, y0, R0, x0, n);
+			top1 = LinearCombinationDifference(T1, R0, x1, R1, y1, n);
+		}
+		assert(top0 == 0 && top1 == 0);
+		std::swap(R0, T0);
+		std::swap(R1, T1);
+
+		if (y)
+		{
+			// the cofactors only grow, by up to a word and a bit, and stay below the original r0
+			U0[ny+1] = LinearCombinationSum(U0, Y0, x0, Y1, y0, ny+1);
+			U1[ny+1] = LinearCombinationSum(U1, Y0, x1, Y1, y1, ny+1);
+			ny += 2;
+			while (!U0[ny-1] && !U1[ny-1])
+				ny--;
+			assert(ny <= N);
+			std::swap(Y0, U0);
+			std::swap(Y1, U1);
+		}
+
+		odd ^= (k%2 != 0);
+	}
+
+	r0.reg.CleanNew(RoundupSize(N));
+	CopyWords(r0.reg, R0, n);
+	r0.sign = Integer::POSITIVE;
+	r1 = Integer::Zero();
+	if (y)
+	{
+		y->reg.CleanNew(RoundupSize(N));
+		CopyWords(y->reg, Y0, ny);
+		y->sign = Integer::POSITIVE;
+	}
+	return odd;
+}
+
+Integer Integer::Gcd(const Integer &a, const Integer &b)
+{
+	Integer r0 = a.AbsoluteValue(), r1 = b.AbsoluteValue();
+	if (r0 < r1)
+		std::swap(r0, r1);
+	LehmerEuclid(r0, r1, NULL);
+	return r0;
+}
+
+Integer Integer::InverseMod(const Integer &m) const
+{
+	assert(m.NotNegative());
+
+	if (m <= One())
+		return Zero();
+
+	if (IsNegative() || *this >= m)
+		return Modulo(m).InverseMod(m);
+
+	Integer r0 = m, r1 = *this, y;
+	bool odd = LehmerEuclid(r0, r1, &y);
+	if (r0 != One())
+		return Zero();	// no inverse
+	return odd ? y : m-y;
 }
 
 word Integer::InverseMod(word mod) const
@@ -4005,6 +4802,161 @@ word Integer::InverseMod(word mod) const
 	return 0;
 }
 
+size_t Integer::KaratsubaThreshold()
+{
+	InitializeInteger();	// so a tuning file is loaded first
+	return s_karatsubaThreshold.Load();
+}
+
+void Integer::SetKaratsubaThreshold(size_t words)
+{
+	InitializeInteger();
+	s_karatsubaThreshold.Store(words);
+}
+
+size_t Integer::Toom3Threshold()
+{
+	InitializeInteger();
+	return s_toom3Threshold.Load();
+}
+
+void Integer::SetToom3Threshold(size_t words)
+{
+	InitializeInteger();
+	// below 8 words the pieces would not be shorter than the operands
+	s_toom3Threshold.Store(words ? STDMAX(words, size_t(8)) : 0);
+}
+
+void Integer::LoadTuning(std::istream &in)
+{
+	InitializeInteger();
+	size_t karatsubaThreshold = s_karatsubaThreshold.Load(), toom3Threshold = s_toom3Threshold.Load();
+	std::string line;
+	while (std::getline(in, line))
+	{
+		std::istringstream fields(line);
+		std::string name;
+		size_t words;
+		if (!(fields >> name) || name[0] == '#')
+			continue;
+		if (!(fields >> words) || !(fields >> std::ws).eof())
+			throw InvalidArgument("Integer: invalid line in tuning file: " + line);
+		if (name == "karatsuba-threshold")
+			karatsubaThreshold = words;
+		else if (name == "toom3-threshold")
+			toom3Threshold = words;
+		else
+			throw InvalidArgument("Integer: unknown setting in tuning file: " + name);
+	}
+	SetKaratsubaThreshold(karatsubaThreshold);
+	SetToom3Threshold(toom3Threshold);
+}
+
+void Integer::SaveTuning(std::ostream &out)
+{
+	InitializeInteger();
+	out << "# operand lengths in words, see Integer::KaratsubaThreshold() and Integer::Toom3Threshold()" << std::endl;
+	out << "karatsuba-threshold " << s_karatsubaThreshold.Load() << std::endl;
+	out << "toom3-threshold " << s_toom3Threshold.Load() << std::endl;
+}
+
+// ********************************************************
+
+static AtomicValue<lword> s_nextArithmeticWorkspaceOwner(1);
+
+lword ArithmeticWorkspace::Owner::NewId()
+{
+	return s_nextArithmeticWorkspaceOwner.FetchAdd(1);
+}
+
+#ifdef THREADS_AVAILABLE
+static ThreadLocalStorage & AccessCurrentArithmeticWorkspace()
+{
+	// never deleted, since objects with static storage duration may release members after exit() starts
+	static ThreadLocalStorage *s_current = new ThreadLocalStorage;
+	return *s_current;
+}
+
+ArithmeticWorkspace * ArithmeticWorkspace::Current()
+{
+	return (ArithmeticWorkspace *)AccessCurrentArithmeticWorkspace().GetValue();
+}
+
+ArithmeticWorkspace::ArithmeticWorkspace()
+	: m_installed(Current() == NULL)
+{
+	if (m_installed)
+		AccessCurrentArithmeticWorkspace().SetValue(this);
+}
+
+ArithmeticWorkspace::~ArithmeticWorkspace()
+{
+	if (m_installed)
+	{
+		AccessCurrentArithmeticWorkspace().SetValue(NULL);
+		for (EntryMap::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+			delete it->second.slot;
+	}
+}
+#else
+static ArithmeticWorkspace *s_currentArithmeticWorkspace = NULL;
+
+ArithmeticWorkspace * ArithmeticWorkspace::Current()
+{
+	return s_currentArithmeticWorkspace;
+}
+
+ArithmeticWorkspace::ArithmeticWorkspace()
+	: m_installed(Current() == NULL)
+{
+	if (m_installed)
+		s_currentArithmeticWorkspace = this;
+}
+
+ArithmeticWorkspace::~ArithmeticWorkspace()
+{
+	if (m_installed)
+	{
+		s_currentArithmeticWorkspace = NULL;
+		for (EntryMap::iterator it = m_entries.begin(); it != m_entries.end(); ++it)
+			delete it->second.slot;
+	}
+}
+#endif
+
+// a slot of a destroyed owner stays until another owner's member has its address, and is then replaced
+ArithmeticWorkspace::SlotBase * ArithmeticWorkspace::Find(lword owner, const void *member, SlotFactory factory)
+{
+	EntryMap::iterator it = m_entries.lower_bound(member);
+	if (it != m_entries.end() && it->first == member)
+	{
+		Entry &entry = it->second;
+		if (entry.owner != owner || entry.factory != factory)
+		{
+			SlotBase *slot = factory(member);
+			delete entry.slot;
+			entry.owner = owner;
+			entry.factory = factory;
+			entry.slot = slot;
+		}
+		return entry.slot;
+	}
+
+	Entry entry = {owner, factory, factory(member)};
+	m_entries.insert(it, EntryMap::value_type(member, entry));
+	return entry.slot;
+}
+
+void ArithmeticWorkspace::Remove(const void *member)
+{
+	EntryMap::iterator it = m_entries.find(member);
+	if (it != m_entries.end())
+	{
+		delete it->second.slot;
+		m_entries.erase(it);
+	}
+}
+
 // ********************************************************
 
 ModularArithmetic::ModularArithmetic(BufferedTransformation &bt)
@@ -4040,30 +4992,33 @@ const Integer& ModularArithmetic::Half(const Integer &a) const
 {
 	if (a.reg.size()==m_modulus.reg.size())
 	{
-		CryptoPP::DivideByPower2Mod(m_result.reg.begin(), a.reg, 1, m_modulus.reg, a.reg.size());
-		return m_result;
+		Integer &result = Result();
+		CryptoPP::DivideByPower2Mod(result.reg.begin(), a.reg, 1, m_modulus.reg, a.reg.size());
+		return result;
 	}
 	else
-		return m_result1 = (a.IsEven() ? (a >> 1) : ((a+m_modulus) >> 1));
+		return Result1() = (a.IsEven() ? (a >> 1) : ((a+m_modulus) >> 1));
 }
 
 const Integer& ModularArithmetic::Add(const Integer &a, const Integer &b) const
 {
 	if (a.reg.size()==m_modulus.reg.size() && b.reg.size()==m_modulus.reg.size())
 	{
-		if (CryptoPP::Add(m_result.reg.begin(), a.reg, b.reg, a.reg.size())
-			|| Compare(m_result.reg, m_modulus.reg, a.reg.size()) >= 0)
+		Integer &result = Result();
+		if (CryptoPP::Add(result.reg.begin(), a.reg, b.reg, a.reg.size())
+			|| Compare(result.reg, m_modulus.reg, a.reg.size()) >= 0)
 		{
-			CryptoPP::Subtract(m_result.reg.begin(), m_result.reg, m_modulus.reg, a.reg.size());
+			CryptoPP::Subtract(result.reg.begin(), result.reg, m_modulus.reg, a.reg.size());
 		}
-		return m_result;
+		return result;
 	}
 	else
 	{
-		m_result1 = a+b;
-		if (m_result1 >= m_modulus)
-			m_result1 -= m_modulus;
-		return m_result1;
+		Integer &result1 = Result1();
+		result1 = a+b;
+		if (result1 >= m_modulus)
+			result1 -= m_modulus;
+		return result1;
 	}
 }
 
@@ -4091,16 +5046,18 @@ const Integer& ModularArithmetic::Subtract(const Integer &a, const Integer &b) c
 {
 	if (a.reg.size()==m_modulus.reg.size() && b.reg.size()==m_modulus.reg.size())
 	{
-		if (CryptoPP::Subtract(m_result.reg.begin(), a.reg, b.reg, a.reg.size()))
-			CryptoPP::Add(m_result.reg.begin(), m_result.reg, m_modulus.reg, a.reg.size());
-		return m_result;
+		Integer &result = Result();
+		if (CryptoPP::Subtract(result.reg.begin(), a.reg, b.reg, a.reg.size()))
+			CryptoPP::Add(result.reg.begin(), result.reg, m_modulus.reg, a.reg.size());
+		return result;
 	}
 	else
 	{
-		m_result1 = a-b;
-		if (m_result1.IsNegative())
-			m_result1 += m_modulus;
-		return m_result1;
+		Integer &result1 = Result1();
+		result1 = a-b;
+		if (result1.IsNegative())
+			result1 += m_modulus;
+		return result1;
 	}
 }
 
@@ -4126,11 +5083,12 @@ const Integer& ModularArithmetic::Inverse(const Integer &a) const
 	if (!a)
 		return a;
 
-	CopyWords(m_result.reg.begin(), m_modulus.reg, m_modulus.reg.size());
-	if (CryptoPP::Subtract(m_result.reg.begin(), m_result.reg, a.reg, a.reg.size()))
-		Decrement(m_result.reg.begin()+a.reg.size(), m_modulus.reg.size()-a.reg.size());
+	Integer &result = Result();
+	CopyWords(result.reg.begin(), m_modulus.reg, m_modulus.reg.size());
+	if (CryptoPP::Subtract(result.reg.begin(), result.reg, a.reg, a.reg.size()))
+		Decrement(result.reg.begin()+a.reg.size(), m_modulus.reg.size()-a.reg.size());
 
-	return m_result;
+	return result;
 }
 
 Integer ModularArithmetic::CascadeExponentiate(const Integer &x, const Integer &e1, const Integer &y, const Integer &e2) const
@@ -4157,6 +5115,21 @@ void ModularArithmetic::SimultaneousExponentiate(Integer *results, const Integer
 		AbstractRing<Integer>::SimultaneousExponentiate(results, base, exponents, exponentsCount);
 }
 
+void ModularArithmetic::SimultaneousInverse(Integer *elements, unsigned int count) const
+{
+	if (m_modulus.IsOdd() && count > 1)
+	{
+		MontgomeryRepresentation dr(m_modulus);
+		for (size_t i=0; i<count; i++)
+			elements[i] = dr.ConvertIn(elements[i]);
+		dr.SimultaneousInverse(elements, count);
+		for (size_t i=0; i<count; i++)
+			elements[i] = dr.ConvertOut(elements[i]);
+	}
+	else
+		AbstractRing<Integer>::SimultaneousInverse(elements, count);
+}
+
 MontgomeryRepresentation::MontgomeryRepresentation(const Integer &m)	// modulus must be odd
 	: ModularArithmetic(m),
 	  m_u((word)0, m_modulus.reg.size()),
@@ -4166,68 +5139,211 @@ MontgomeryRepresentation::MontgomeryRepresentation(const Integer &m)	// modulus
 		throw InvalidArgument("MontgomeryRepresentation: Montgomery representation requires an odd modulus");
 
 	RecursiveInverseModPower2(m_u.reg, m_workspace, m_modulus.reg, m_modulus.reg.size());
+
+	const size_t rBits = WORD_BITS*m_modulus.reg.size();
+	m_one = Integer::Power2(rBits) % m_modulus;
+	m_r2 = (m_one << rBits) % m_modulus;
+}
+
+Integer MontgomeryRepresentation::ConvertIn(const Integer &a) const
+{
+	// multiplying by r^2 takes a Montgomery reduction instead of a division
+	if (a.NotNegative() && a.reg.size() <= m_modulus.reg.size() && a < m_modulus)
+		return Multiply(a, m_r2);
+
+	return (a<<(WORD_BITS*m_modulus.reg.size()))%m_modulus;
 }
 
 const Integer& MontgomeryRepresentation::Multiply(const Integer &a, const Integer &b) const
 {
-	word *const T = m_workspace.begin();
-	word *const R = m_result.reg.begin();
+	Integer &result = Result();
+	word *const T = Workspace().begin();
+	word *const R = result.reg.begin();
 	const size_t N = m_modulus.reg.size();
 	assert(a.reg.size()<=N && b.reg.size()<=N);
 
+	// above 32 words Karatsuba followed by a separate reduction is faster
+	if (s_pMontMul && N%4 == 0 && N <= 32)
+	{
+		// the fused kernel takes both operands at full length
+		const word *A = a.reg, *B = b.reg;
+		if (a.reg.size() < N)
+		{
+			CopyWords(T, a.reg, a.reg.size());
+			SetWords(T+a.reg.size(), 0, N-a.reg.size());
+			A = T;
+		}
+		if (b.reg.size() < N)
+		{
+			CopyWords(T+N, b.reg, b.reg.size());
+			SetWords(T+N+b.reg.size(), 0, N-b.reg.size());
+			B = T+N;
+		}
+		s_pMontMul(R, T+2*N, A, B, m_modulus.reg, 0-m_u.reg[0], N);
+		return result;
+	}
+
 	AsymmetricMultiply(T, T+2*N, a.reg, a.reg.size(), b.reg, b.reg.size());
 	SetWords(T+a.reg.size()+b.reg.size(), 0, 2*N-a.reg.size()-b.reg.size());
 	MontgomeryReduce(R, T+2*N, T, m_modulus.reg, m_u.reg, N);
-	return m_result;
+	return result;
 }
 
 const Integer& MontgomeryRepresentation::Square(const Integer &a) const
 {
-	word *const T = m_workspace.begin();
-	word *const R = m_result.reg.begin();
+	Integer &result = Result();
+	word *const T = Workspace().begin();
+	word *const R = result.reg.begin();
 	const size_t N = m_modulus.reg.size();
 	assert(a.reg.size()<=N);
 
+	// the unrolled 4-word kernel is faster than squaring and reducing separately
+	if (s_pMontMul && N == 4)
+	{
+		const word *A = a.reg;
+		if (a.reg.size() < N)
+		{
+			CopyWords(T, a.reg, a.reg.size());
+			SetWords(T+a.reg.size(), 0, N-a.reg.size());
+			A = T;
+		}
+		s_pMontMul(R, T+N, A, A, m_modulus.reg, 0-m_u.reg[0], N);
+		return result;
+	}
+
 	CryptoPP::Square(T, T+2*N, a.reg, a.reg.size());
 	SetWords(T+2*a.reg.size(), 0, 2*N-2*a.reg.size());
 	MontgomeryReduce(R, T+2*N, T, m_modulus.reg, m_u.reg, N);
-	return m_result;
+	return result;
 }
 
 Integer MontgomeryRepresentation::ConvertOut(const Integer &a) const
 {
-	word *const T = m_workspace.begin();
-	word *const R = m_result.reg.begin();
+	Integer &result = Result();
+	word *const T = Workspace().begin();
+	word *const R = result.reg.begin();
 	const size_t N = m_modulus.reg.size();
 	assert(a.reg.size()<=N);
 
 	CopyWords(T, a.reg, a.reg.size());
 	SetWords(T+a.reg.size(), 0, 2*N-a.reg.size());
 	MontgomeryReduce(R, T+2*N, T, m_modulus.reg, m_u.reg, N);
-	return m_result;
+	return result;
 }
 
 const Integer& MontgomeryRepresentation::MultiplicativeInverse(const Integer &a) const
 {
 //	  return (EuclideanMultiplicativeInverse(a, modulus)<<(2*WORD_BITS*modulus.reg.size()))%modulus;
-	word *const T = m_workspace.begin();
-	word *const R = m_result.reg.begin();
+	Integer &result = Result();
+	word *const T = Workspace().begin();
+	word *const R = result.reg.begin();
 	const size_t N = m_modulus.reg.size();
 	assert(a.reg.size()<=N);
 
 	CopyWords(T, a.reg, a.reg.size());
 	SetWords(T+a.reg.size(), 0, 2*N-a.reg.size());
 	MontgomeryReduce(R, T+2*N, T, m_modulus.reg, m_u.reg, N);
-	unsigned k = AlmostInverse(R, T, R, N, m_modulus.reg, N);
 
-//	cout << "k=" << k << " N*32=" << 32*N << endl;
+	Integer r0 = m_modulus, r1 = result, y;
+	bool odd = LehmerEuclid(r0, r1, &y);
+	SetWords(R, 0, N);
+	if (r0 == Integer::One())
+	{
+		y = ((odd ? y : m_modulus-y) << (N*WORD_BITS)) % m_modulus;
+		CopyWords(R, y.reg, y.WordCount());
+	}
 
-	if (k>N*WORD_BITS)
-		DivideByPower2Mod(R, R, k-N*WORD_BITS, m_modulus.reg, N);
-	else
-		MultiplyByPower2Mod(R, R, N*WORD_BITS-k, m_modulus.reg, N);
+	return result;
+}
 
-	return m_result;
+// ********************************************************
+
+BarrettReducer::BarrettReducer(const Integer &m)
+	: m_modulus(m), m_n(m.WordCount()), m_l(m_n+1 + (m_n+1)%2)
+{
+	if (m_modulus.IsPositive())
+	{
+		Integer mu = (Integer::Power2(2*m_n*WORD_BITS) - 1) / m_modulus;
+		m_modulusWords.CleanNew(m_l);
+		CopyWords(m_modulusWords, m_modulus.reg, m_n);
+		m_muWords.CleanNew(m_l);
+		CopyWords(m_muWords, mu.reg, mu.WordCount());
+	}
+}
+
+// R[L] ----- result = X mod M, with the words above N zero
+// T[3*L] --- temporary work space
+// X[2*N] --- a non-negative integer below b^(2*N)
+// this is algorithm 14.42 from the Handbook of Applied Cryptography, with
+// mu rounded down by one when M is a power of b, which costs at most one more subtraction
+
+void BarrettReducer::ReduceWords(word *R, word *T, const word *X) const
+{
+	const size_t N = m_n, L = m_l;
+	const word *const M = m_modulusWords, *const U = m_muWords;
+	word *const Q2 = T, *const Q3 = T+2*L;
+
+	// Q2 = floor(X / b^(N-1)) * mu, of which only the words above N+1 are used
+	const word *Q1 = X+N-1;
+	Q2[N+1] = LinearMultiply(Q2, Q1, U[0], N+1);
+	for (size_t i=1; i<=N; i++)
+		Q2[N+1+i] = LinearMultiplyAccumulate(Q2+i, Q1, U[i], N+1);
+
+	// R = X - Q3*M mod b^(N+1), where Q3 = floor(Q2 / b^(N+1))
+	CopyWords(Q3, Q2+N+1, N+1);
+	SetWords(Q2, 0, L);
+	for (size_t i=0; i<=N; i++)
+		LinearMultiplyAccumulate(Q2+i, M, Q3[i], N+1-i);
+
+	CopyWords(R, X, N+1);
+	SetWords(R+N+1, 0, L-N-1);
+	Subtract(R, R, Q2, L);
+	SetWords(R+N+1, 0, L-N-1);
+
+	while (Compare(R, M, L) >= 0)
+		Subtract(R, R, M, L);
+}
+
+Integer BarrettReducer::Reduce(const Integer &a) const
+{
+	if (!m_modulus.IsPositive())
+		return a % m_modulus;
+
+	if (a.IsNegative())
+	{
+		Integer r = Reduce(-a);
+		return r.IsZero() ? r : m_modulus - r;
+	}
+
+	const size_t N = m_n, L = m_l;
+	size_t na = a.WordCount();
+	if (na < N || (na == N && a < m_modulus))
+		return a;
+
+	// X[2*N], T[3*L]
+	IntegerSecBlock T(2*N + 3*L);
+	word *const X = T+3*L;
+	Integer result((word)0, L);
+	word *const R = result.reg;
+
+	// reduce the top 2*N words, then bring in the rest of a up to N words at a time
+	size_t c = STDMIN(na, 2*N);
+	na -= c;
+	CopyWords(X, a.reg+na, c);
+	SetWords(X+c, 0, 2*N-c);
+	ReduceWords(R, T, X);
+
+	while (na)
+	{
+		c = STDMIN(na, N);
+		na -= c;
+		CopyWords(X, a.reg+na, c);
+		CopyWords(X+c, R, N);
+		SetWords(X+c+N, 0, N-c);
+		ReduceWords(R, T, X);
+	}
+
+	return result;
 }
 
 NAMESPACE_END
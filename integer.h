@@ -16,7 +16,9 @@ struct InitializeInteger	// used to initialize static variables
 	InitializeInteger();
 };
 
-typedef SecBlock<word, AllocatorWithCleanup<word, CRYPTOPP_BOOL_X86> > IntegerSecBlock;
+// Up to 8 words are kept inside the object instead of on the heap. That covers the field elements
+// and orders of elliptic curves up to 384 bits, DSA subgroup orders, and products of the shorter ones.
+typedef SecBlock<word, FixedSizeAllocatorWithCleanup<word, 8, AllocatorWithCleanup<word, CRYPTOPP_BOOL_X86>, CRYPTOPP_BOOL_X86> > IntegerSecBlock;
 
 //! multiple precision integer and basic arithmetics
 /*! This class can represent positive and negative integers
@@ -337,6 +339,10 @@ public:
 		CRYPTOPP_DLL friend Integer CRYPTOPP_API a_times_b_mod_c(const Integer &x, const Integer& y, const Integer& m);
 		//! modular exponentiation
 		CRYPTOPP_DLL friend Integer CRYPTOPP_API a_exp_b_mod_c(const Integer &x, const Integer& e, const Integer& m);
+		//! modular exponentiation of many bases, results[i] = x[i]^e mod m for i < count
+		/*! With AVX-512 IFMA and an odd m, eight exponentiations run at once in the lanes of a vector.
+			The time taken depends on e, so e should be public. */
+		CRYPTOPP_DLL friend void CRYPTOPP_API a_exp_b_mod_c(Integer *results, const Integer *x, size_t count, const Integer& e, const Integer& m);
 
 		//! calculate r and q such that (a == d*q + r) && (0 <= r < abs(d))
 		static void CRYPTOPP_API Divide(Integer &r, Integer &q, const Integer &a, const Integer &d);
@@ -354,6 +360,27 @@ public:
 		word InverseMod(word n) const;
 	//@}
 
+	//! \name TUNING
+	//@{
+		//! operand length in words from which multiplication uses Karatsuba instead of schoolbook multiplication, or 0 for the default
+		/*! The default uses Karatsuba for every length above that of the largest fixed size multiplication kernel. */
+		static size_t CRYPTOPP_API KaratsubaThreshold();
+		//! set the length returned by KaratsubaThreshold()
+		static void CRYPTOPP_API SetKaratsubaThreshold(size_t words);
+		//! operand length in words from which multiplication uses Toom-3 instead of Karatsuba, or 0 if never
+		static size_t CRYPTOPP_API Toom3Threshold();
+		//! set the length returned by Toom3Threshold(), which starts out as CRYPTOPP_TOOM3_THRESHOLD
+		static void CRYPTOPP_API SetToom3Threshold(size_t words);
+		//! set the thresholds above from a tuning file, as written by SaveTuning()
+		/*! The library calls this when it starts if the environment variable CRYPTOPP_INTEGER_TUNING
+			names a file, such as one written by "cryptest.exe tune". A file that cannot be read
+			or parsed then leaves the defaults in place. Throws InvalidArgument if a line
+			cannot be parsed, in which case no threshold is changed. */
+		static void CRYPTOPP_API LoadTuning(std::istream &in);
+		//! write the current thresholds in the format read by LoadTuning()
+		static void CRYPTOPP_API SaveTuning(std::ostream &out);
+	//@}
+
 	//! \name INPUT/OUTPUT
 	//@{
 		//!
@@ -366,6 +393,7 @@ private:
 	friend class ModularArithmetic;
 	friend class MontgomeryRepresentation;
 	friend class HalfMontgomeryRepresentation;
+	friend class BarrettReducer;
 
 	Integer(word value, size_t length);
 
@@ -374,6 +402,7 @@ private:
 	friend void PositiveSubtract(Integer &diff, const Integer &a, const Integer &b);
 	friend void PositiveMultiply(Integer &product, const Integer &a, const Integer &b);
 	friend void PositiveDivide(Integer &remainder, Integer &quotient, const Integer &dividend, const Integer &divisor);
+	friend bool LehmerEuclid(Integer &r0, Integer &r1, Integer *y);
 
 	IntegerSecBlock reg;
 	Sign sign;
@@ -18,18 +18,18 @@ void LUC_TestInstantiations()
 
 void DL_Algorithm_LUC_HMP::Sign(const DL_GroupParameters<Integer> &params, const Integer &x, const Integer &k, const Integer &e, Integer &r, Integer &s) const
 {
-	const Integer &q = params.GetSubgroupOrder();
+	const BarrettReducer &q = params.GetSubgroupOrderReducer();
 	r = params.ExponentiateBase(k);
-	s = (k + x*(r+e)) % q;
+	s = q.Reduce(k + x*(r+e));
 }
 
 bool DL_Algorithm_LUC_HMP::Verify(const DL_GroupParameters<Integer> &params, const DL_PublicKey<Integer> &publicKey, const Integer &e, const Integer &r, const Integer &s) const
 {
 	Integer p = params.GetGroupOrder()-1;
-	const Integer &q = params.GetSubgroupOrder();
+	const BarrettReducer &q = params.GetSubgroupOrderReducer();
 
 	Integer Vsg = params.ExponentiateBase(s);
-	Integer Vry = publicKey.ExponentiatePublicElement((r+e)%q);
+	Integer Vry = publicKey.ExponentiatePublicElement(q.Reduce(r+e));
 	return (Vsg*Vsg + Vry*Vry + r*r) % p == (Vsg * Vry * r + 4) % p;
 }
 
@@ -133,6 +133,7 @@ class DL_BasePrecomputation_LUC : public DL_FixedBasePrecomputation<Integer>
 public:
 	// DL_FixedBasePrecomputation
 	bool IsInitialized() const {return m_g.NotZero();}
+	bool IsPrecomputed() const {return false;}
 	void SetBase(const DL_GroupPrecomputation<Element> &group, const Integer &base) {m_g = base;}
 	const Integer & GetBase(const DL_GroupPrecomputation<Element> &group) const {return m_g;}
 	void Precompute(const DL_GroupPrecomputation<Element> &group, unsigned int maxExpBits, unsigned int storage) {}
@@ -6,6 +6,8 @@
 
 #include "misc.h"
 #include "words.h"
+#include "secblock.h"
+#include "trdlocal.h"
 #include <new>
 
 #if defined(CRYPTOPP_MEMALIGN_AVAILABLE) || defined(CRYPTOPP_MM_MALLOC_AVAILABLE) || defined(QNX)
@@ -182,6 +184,154 @@ void UnalignedDeallocate(void *p)
 	free(p);
 }
 
+// ********************************************************
+
+#ifdef CRYPTOPP_SCRATCH_ARENA
+
+// number of arenas in effect on any thread, so that allocations skip looking up the current
+// arena while there are none
+static AtomicValue<unsigned int> s_scratchArenas(0);
+
+static inline bool AnyScratchArena()
+{
+	return s_scratchArenas.Load() != 0;
+}
+
+#ifdef THREADS_AVAILABLE
+static ThreadLocalStorage & AccessCurrentScratchArena()
+{
+	// never deleted, since objects with static storage duration may free memory after exit() starts
+	static ThreadLocalStorage *s_current = new ThreadLocalStorage;
+	return *s_current;
+}
+
+ScratchArena * ScratchArena::Current()
+{
+	return (ScratchArena *)AccessCurrentScratchArena().GetValue();
+}
+
+ScratchArena::ScratchArena(unsigned int maxBlocks)
+	: m_maxBlocks(maxBlocks), m_scopes(0), m_reused(0), m_installed(Current() == NULL)
+{
+	m_blocks.reserve(maxBlocks);
+	if (m_installed)
+	{
+		AccessCurrentScratchArena().SetValue(this);
+		s_scratchArenas.FetchAdd(1);
+	}
+}
+
+ScratchArena::~ScratchArena()
+{
+	if (m_installed)
+	{
+		AccessCurrentScratchArena().SetValue(NULL);
+		s_scratchArenas.FetchSub(1);
+		Reset();
+	}
+}
+#else
+static ScratchArena *s_currentScratchArena = NULL;
+
+ScratchArena * ScratchArena::Current()
+{
+	return s_currentScratchArena;
+}
+
+ScratchArena::ScratchArena(unsigned int maxBlocks)
+	: m_maxBlocks(maxBlocks), m_scopes(0), m_reused(0), m_installed(Current() == NULL)
+{
+	m_blocks.reserve(maxBlocks);
+	if (m_installed)
+	{
+		s_currentScratchArena = this;
+		s_scratchArenas.FetchAdd(1);
+	}
+}
+
+ScratchArena::~ScratchArena()
+{
+	if (m_installed)
+	{
+		s_currentScratchArena = NULL;
+		s_scratchArenas.FetchSub(1);
+		Reset();
+	}
+}
+#endif
+
+ScratchArena::Scope::Scope()
+	: m_arena(AnyScratchArena() ? ScratchArena::Current() : NULL)
+{
+	if (m_arena)
+		m_arena->m_scopes++;
+}
+
+ScratchArena::Scope::~Scope()
+{
+	if (m_arena && --m_arena->m_scopes == 0)
+		m_arena->Reset();
+}
+
+void * ScratchArena::Allocate(size_t size, bool aligned)
+{
+	ScratchArena *arena = AnyScratchArena() ? Current() : NULL;
+	if (arena && arena->m_scopes)
+	{
+		std::vector<Block> &blocks = arena->m_blocks;
+		for (size_t i=blocks.size(); i>0; i--)
+		{
+			if (blocks[i-1].size == size && blocks[i-1].aligned == aligned)
+			{
+				void *p = blocks[i-1].p;
+				blocks[i-1] = blocks.back();
+				blocks.pop_back();
+				arena->m_reused++;
+				return p;
+			}
+		}
+	}
+
+#if CRYPTOPP_BOOL_ALIGN16_ENABLED
+	if (aligned)
+		return AlignedAllocate(size);
+#endif
+	return UnalignedAllocate(size);
+}
+
+void ScratchArena::Deallocate(void *p, size_t size, bool aligned)
+{
+	if (p == NULL)
+		return;
+
+	Block block = {p, size, aligned};
+	// empty blocks are never requested again, so they are not worth a slot
+	ScratchArena *arena = AnyScratchArena() && size != 0 ? Current() : NULL;
+	if (arena && arena->m_scopes && arena->m_blocks.size() < arena->m_maxBlocks)
+		arena->m_blocks.push_back(block);
+	else
+		Free(block);
+}
+
+void ScratchArena::Free(const Block &block)
+{
+#if CRYPTOPP_BOOL_ALIGN16_ENABLED
+	if (block.aligned)
+		return AlignedDeallocate(block.p);
+#endif
+	UnalignedDeallocate(block.p);
+}
+
+void ScratchArena::Reset()
+{
+	// the blocks were wiped when they were released
+	for (size_t i=0; i<m_blocks.size(); i++)
+		Free(m_blocks[i]);
+	m_blocks.clear();
+}
+
+#endif	// CRYPTOPP_SCRATCH_ARENA
+
 NAMESPACE_END
 
 #endif
@@ -41,6 +41,10 @@
 #include <byteswap.h>
 #endif
 
+#ifdef CRYPTOPP_CXX11_ATOMICS
+#include <atomic>
+#endif
+
 NAMESPACE_BEGIN(CryptoPP)
 
 // ************** compile-time assertion ***************
@@ -94,6 +98,121 @@ private:
     void operator=(const NotCopyable &);
 };
 
+//! a value that several threads may read and update, with the part of std::atomic that the library uses
+/*! Without CRYPTOPP_CXX11_ATOMICS this is a plain variable (see config.h). The constructor is constexpr
+	where the compiler allows it, so that a static AtomicValue is set before any other static object uses it. */
+template <class T>
+class AtomicValue
+{
+public:
+	CRYPTOPP_CONSTEXPR AtomicValue(T value = T()) : m_value(value) {}
+
+#ifdef CRYPTOPP_CXX11_ATOMICS
+	T Load() const {return m_value.load();}
+	void Store(T value) {m_value.store(value);}
+	T FetchAdd(T delta) {return m_value.fetch_add(delta);}
+	T FetchSub(T delta) {return m_value.fetch_sub(delta);}
+	bool CompareExchange(T &expected, T desired) {return m_value.compare_exchange_strong(expected, desired);}
+
+private:
+	std::atomic<T> m_value;
+#else
+	T Load() const {return m_value;}
+	void Store(T value) {m_value = value;}
+	T FetchAdd(T delta) {T old = m_value; m_value += delta; return old;}
+	T FetchSub(T delta) {T old = m_value; m_value -= delta; return old;}
+	bool CompareExchange(T &expected, T desired)
+	{
+		if (m_value != expected)
+		{
+			expected = m_value;
+			return false;
+		}
+		m_value = desired;
+		return true;
+	}
+
+private:
+	T m_value;
+#endif
+
+	AtomicValue(const AtomicValue &);
+	void operator=(const AtomicValue &);
+};
+
+//! a few objects of type T that threads borrow one at a time, so that a const object shared by threads can keep state between calls
+/*! A thread claims a free slot with an atomic exchange for as long as its Borrowed object exists,
+	and gets an object of its own if all SLOTS slots are in use. Slot objects are created on first use
+	and kept until the pool is destroyed, and a copy of a pool starts empty. Without CRYPTOPP_CXX11_ATOMICS
+	no slot is ever claimed, so every Borrowed object has an object of its own. */
+template <class T, unsigned int SLOTS = 8>
+class SlotPool
+{
+public:
+	SlotPool() {}
+	SlotPool(const SlotPool &) {}
+	SlotPool & operator=(const SlotPool &) {return *this;}
+
+	class Borrowed
+	{
+	public:
+		Borrowed(const SlotPool &pool) : m_pool(pool), m_slot(pool.Claim())
+		{
+			if (m_slot == SLOTS)
+				m_local.reset(new T);
+			else if (!pool.m_objects[m_slot].get())
+			{
+				try
+				{
+					pool.m_objects[m_slot].reset(new T);
+				}
+				catch (...)
+				{
+					pool.m_busy[m_slot].Store(0);
+					throw;
+				}
+			}
+			m_object = m_slot < SLOTS ? pool.m_objects[m_slot].get() : m_local.get();
+		}
+		~Borrowed()
+		{
+			if (m_slot < SLOTS)
+				m_pool.m_busy[m_slot].Store(0);
+		}
+
+		T & operator*() const {return *m_object;}
+		T * operator->() const {return m_object;}
+
+	private:
+		Borrowed(const Borrowed &);
+		void operator=(const Borrowed &);
+
+		const SlotPool &m_pool;
+		unsigned int m_slot;
+		member_ptr<T> m_local;
+		T *m_object;
+	};
+
+private:
+	friend class Borrowed;
+
+	unsigned int Claim() const
+	{
+#ifdef CRYPTOPP_CXX11_ATOMICS
+		for (unsigned int i=0; i<SLOTS; i++)
+		{
+			int expected = 0;
+			if (m_busy[i].Load() == 0 && m_busy[i].CompareExchange(expected, 1))
+				return i;
+		}
+#endif
+		return SLOTS;
+	}
+
+	mutable AtomicValue<int> m_busy[SLOTS];
+	mutable member_ptr<T> m_objects[SLOTS];
+};
+
 template <class T>
 struct NewObject
 {
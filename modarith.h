@@ -31,6 +31,9 @@ public:
 
 	ModularArithmetic(BufferedTransformation &bt);	// construct from BER encoded parameters
 
+	~ModularArithmetic()
+		{ArithmeticWorkspace::Release(m_result); ArithmeticWorkspace::Release(m_result1);}
+
 	virtual ModularArithmetic * Clone() const {return new ModularArithmetic(*this);}
 
 	void DEREncode(BufferedTransformation &bt) const;
@@ -39,7 +42,7 @@ public:
 	void BERDecodeElement(BufferedTransformation &in, Element &a) const;
 
 	const Integer& GetModulus() const {return m_modulus;}
-	void SetModulus(const Integer &newModulus) {m_modulus = newModulus; m_result.reg.resize(m_modulus.reg.size());}
+	void SetModulus(const Integer &newModulus) {m_modulus = newModulus; m_result.reg.resize(m_modulus.reg.size()); m_owner.Renew();}
 
 	virtual bool IsMontgomeryRepresentation() const {return false;}
 
@@ -74,16 +77,16 @@ public:
 		{return Integer::One();}
 
 	const Integer& Multiply(const Integer &a, const Integer &b) const
-		{return m_result1 = a*b%m_modulus;}
+		{return Result1() = a*b%m_modulus;}
 
 	const Integer& Square(const Integer &a) const
-		{return m_result1 = a.Squared()%m_modulus;}
+		{return Result1() = a.Squared()%m_modulus;}
 
 	bool IsUnit(const Integer &a) const
 		{return Integer::Gcd(a, m_modulus).IsUnit();}
 
 	const Integer& MultiplicativeInverse(const Integer &a) const
-		{return m_result1 = a.InverseMod(m_modulus);}
+		{return Result1() = a.InverseMod(m_modulus);}
 
 	const Integer& Divide(const Integer &a, const Integer &b) const
 		{return Multiply(a, MultiplicativeInverse(b));}
@@ -92,6 +95,8 @@ public:
 
 	void SimultaneousExponentiate(Element *results, const Element &base, const Integer *exponents, unsigned int exponentsCount) const;
 
+	void SimultaneousInverse(Element *elements, unsigned int count) const;
+
 	unsigned int MaxElementBitLength() const
 		{return (m_modulus-1).BitCount();}
 
@@ -110,8 +115,19 @@ public:
 	static const RandomizationParameter DefaultRandomizationParameter ;
 
 protected:
+	Integer & Result() const
+	{
+		// a workspace copy of m_result may not have kept its full register size
+		Integer &result = ArithmeticWorkspace::Scratch(m_owner, m_result);
+		if (result.reg.size() != m_modulus.reg.size())
+			result.reg.resize(m_modulus.reg.size());
+		return result;
+	}
+	Integer & Result1() const {return ArithmeticWorkspace::Scratch(m_owner, m_result1);}
+
 	Integer m_modulus;
 	mutable Integer m_result, m_result1;
+	ArithmeticWorkspace::Owner m_owner;
 
 };
 
@@ -123,18 +139,19 @@ class CRYPTOPP_DLL MontgomeryRepresentation : public ModularArithmetic
 {
 public:
 	MontgomeryRepresentation(const Integer &modulus);	// modulus must be odd
+	~MontgomeryRepresentation()
+		{ArithmeticWorkspace::Release(m_workspace);}
 
 	virtual ModularArithmetic * Clone() const {return new MontgomeryRepresentation(*this);}
 
 	bool IsMontgomeryRepresentation() const {return true;}
 
-	Integer ConvertIn(const Integer &a) const
-		{return (a<<(WORD_BITS*m_modulus.reg.size()))%m_modulus;}
+	Integer ConvertIn(const Integer &a) const;
 
 	Integer ConvertOut(const Integer &a) const;
 
 	const Integer& MultiplicativeIdentity() const
-		{return m_result1 = Integer::Power2(WORD_BITS*m_modulus.reg.size())%m_modulus;}
+		{return m_one;}
 
 	const Integer& Multiply(const Integer &a, const Integer &b) const;
 
@@ -148,11 +165,92 @@ public:
 	void SimultaneousExponentiate(Element *results, const Element &base, const Integer *exponents, unsigned int exponentsCount) const
 		{AbstractRing<Integer>::SimultaneousExponentiate(results, base, exponents, exponentsCount);}
 
+	void SimultaneousInverse(Element *elements, unsigned int count) const
+		{AbstractRing<Integer>::SimultaneousInverse(elements, count);}
+
 private:
-	Integer m_u;
+	IntegerSecBlock & Workspace() const {return ArithmeticWorkspace::Scratch(m_owner, m_workspace);}
+
+	Integer m_u, m_one, m_r2;	// r mod n and r^2 mod n
 	mutable IntegerSecBlock m_workspace;
 };
 
+//! Montgomery arithmetic for a modulus that rarely changes, such as the modulus of a key
+/*! Set() builds the MontgomeryRepresentation when the modulus is set, and Get() never modifies
+	the object, so a const key holding one may be used by several threads. A MontgomeryRepresentation
+	keeps its results in itself unless the thread has an ArithmeticWorkspace, so only such threads
+	get the shared object; others get a private copy, kept in the member_ptr passed to Get(). */
+class CRYPTOPP_DLL CachedMontgomeryRepresentation
+{
+public:
+	//! builds the arithmetic modulo m, or drops it if m is not positive and odd
+	void Set(const Integer &m)
+	{
+		if (!m.IsPositive() || m.IsEven())
+			m_mr.reset();
+		else if (!m_mr.get())
+			m_mr.reset(new MontgomeryRepresentation(m));
+		else if (m_mr->GetModulus() != m)
+			*m_mr = MontgomeryRepresentation(m);	// in place; the assignment gives it a new ArithmeticWorkspace::Owner
+	}
+
+	//! returns Montgomery arithmetic modulo m, which must be odd
+	/*! A private copy is made in local if the calling thread has no ArithmeticWorkspace, and
+		a new object if Set() was not called with m, for instance after the key changed through
+		a base class. local is used as it is if it already holds arithmetic modulo m, so a caller
+		that keeps it between calls, as RSA keys do in a SlotPool, makes the copy only once. */
+	const MontgomeryRepresentation & Get(const Integer &m, member_ptr<MontgomeryRepresentation> &local) const
+	{
+		if (local.get() && local->GetModulus() == m)
+			return *local;
+		if (m_mr.get() && m_mr->GetModulus() == m)
+		{
+			if (ArithmeticWorkspace::IsActive())
+				return *m_mr;
+			local.reset(new MontgomeryRepresentation(*m_mr));
+		}
+		else
+			local.reset(new MontgomeryRepresentation(m));
+		return *local;
+	}
+
+private:
+	value_ptr<MontgomeryRepresentation> m_mr;
+};
+
+//! reduces integers modulo a fixed modulus with Barrett's method
+/*! The constructor computes mu = floor((b^(2n)-1)/m), where b is 2^WORD_BITS and m is n words long.
+	Reducing a non-negative integer below b^(2n), such as the product of two residues, then takes two
+	multiplications and at most three subtractions instead of a division. Longer integers are
+	reduced n words at a time, and negative ones through their absolute value. The reducer has no mutable state, so one object can be shared by all threads.
+	It is meant for moduli of a few words, such as the order of a DL subgroup. */
+class CRYPTOPP_DLL BarrettReducer
+{
+public:
+	//! a positive modulus is required before Reduce() can be used
+	BarrettReducer(const Integer &modulus = Integer::One());
+
+	const Integer& GetModulus() const {return m_modulus;}
+
+	//! returns the smallest non-negative integer congruent to a
+	Integer Reduce(const Integer &a) const;
+
+	//! returns a*b reduced
+	Integer Multiply(const Integer &a, const Integer &b) const
+		{return Reduce(a*b);}
+
+	bool operator==(const BarrettReducer &rhs) const
+		{return m_modulus == rhs.m_modulus;}
+
+private:
+	void ReduceWords(word *R, word *T, const word *X) const;
+
+	// modulus and mu, each zero extended to m_l words
+	Integer m_modulus;
+	IntegerSecBlock m_modulusWords, m_muWords;
+	size_t m_n, m_l;
+};
+
 NAMESPACE_END
 
 #endif
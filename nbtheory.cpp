@@ -618,6 +618,20 @@ Integer ModularSquareRoot(const Integer &a, const Integer &p)
 	return x;
 }
 
+Integer ModularSquareRoot(const MontgomeryRepresentation &mr, const Integer &a, int &legendre)
+{
+	const Integer &p = mr.GetModulus();
+	assert(p%4 == 3);
+
+	// with t = a^((p-3)/4), the root is t*a and the Legendre symbol is t*t*a = a^((p-1)/2)
+	Integer am = mr.ConvertIn(a);
+	Integer t = mr.Exponentiate(am, p >> 2);
+	Integer root = mr.Multiply(t, am);
+	Integer symbol = mr.ConvertOut(mr.Multiply(root, t));
+	legendre = symbol.IsZero() ? 0 : (symbol == Integer::One() ? 1 : -1);
+	return mr.ConvertOut(root);
+}
+
 bool SolveModularQuadraticEquation(Integer &r1, Integer &r2, const Integer &a, const Integer &b, const Integer &c, const Integer &p)
 {
 	Integer D = (b.Squared() - 4*a*c) % p;
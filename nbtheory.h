@@ -8,6 +8,8 @@
 
 NAMESPACE_BEGIN(CryptoPP)
 
+class MontgomeryRepresentation;
+
 // obtain pointer to small prime table and get its size
 CRYPTOPP_DLL const word16 * CRYPTOPP_API GetPrimeTable(unsigned int &size);
 
@@ -85,6 +87,10 @@ inline Integer ModularExponentiation(const Integer &a, const Integer &e, const I
 	{return a_exp_b_mod_c(a, e, m);}
 // returns x such that x*x%p == a, p prime
 CRYPTOPP_DLL Integer CRYPTOPP_API ModularSquareRoot(const Integer &a, const Integer &p);
+// for a prime p == 3 mod 4 and 0 <= a < p, returns a^((p+1)/4) mod p, which is a square root of a if a is a
+// square mod p and of -a otherwise, and sets legendre to the Legendre symbol of a from the same exponentiation;
+// mr is the Montgomery representation of p, which callers that take many roots mod p keep
+CRYPTOPP_DLL Integer CRYPTOPP_API ModularSquareRoot(const MontgomeryRepresentation &mr, const Integer &a, int &legendre);
 // returns x such that a==ModularExponentiation(x, e, p*q), p q primes,
 // and e relatively prime to (p-1)*(q-1)
 // dp=d%(p-1), dq=d%(q-1), (d is inverse of e mod (p-1)*(q-1))
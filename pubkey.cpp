@@ -22,6 +22,100 @@ void P1363_MGF1KDF2_Common(HashTransformation &hash, byte *output, size_t output
 	}
 }
 
+AtomicValue<unsigned int> DL_AdaptivePrecomputation::s_thresholdUses(0);
+AtomicValue<unsigned int> DL_AdaptivePrecomputation::s_storage(16);
+AtomicValue<size_t> DL_AdaptivePrecomputation::s_memoryBudget(0);
+AtomicValue<size_t> DL_AdaptivePrecomputation::s_memoryInUse(0);
+
+DL_AdaptivePrecomputation::DL_AdaptivePrecomputation(const DL_AdaptivePrecomputation &other)
+	: m_uses(0), m_bytes(0), m_state(COUNTING)
+{
+	CopyState(other);
+}
+
+DL_AdaptivePrecomputation & DL_AdaptivePrecomputation::operator=(const DL_AdaptivePrecomputation &other)
+{
+	if (this != &other)
+	{
+		Release();
+		CopyState(other);
+	}
+	return *this;
+}
+
+// a copy of a key only takes tables that are complete, and they are charged to the budget without checking it
+void DL_AdaptivePrecomputation::CopyState(const DL_AdaptivePrecomputation &other)
+{
+	int state = other.m_state.Load();
+	if (state == READY && other.m_bytes != 0)
+	{
+		m_bytes = other.m_bytes;
+		s_memoryInUse.FetchAdd(m_bytes);
+	}
+	m_uses.Store(other.m_uses.Load());
+	m_state.Store(state == BUILDING ? COUNTING : state);
+}
+
+void DL_AdaptivePrecomputation::SetPolicy(unsigned int thresholdUses, size_t memoryBudget, unsigned int storage)
+{
+	if (storage < 2)
+		throw InvalidArgument("DL_AdaptivePrecomputation: storage must be at least 2");
+	s_thresholdUses.Store(thresholdUses);
+	s_memoryBudget.Store(memoryBudget);
+	s_storage.Store(storage);
+}
+
+bool DL_AdaptivePrecomputation::CountUse()
+{
+	unsigned int thresholdUses = s_thresholdUses.Load();
+	if (thresholdUses == 0 || m_state.Load() != COUNTING)
+		return false;
+	if (m_uses.FetchAdd(1) + 1 < thresholdUses)
+		return false;
+	int state = COUNTING;
+	return m_state.CompareExchange(state, BUILDING);
+}
+
+bool DL_AdaptivePrecomputation::Reserve(size_t tableBytes)
+{
+	assert(m_bytes == 0 && m_state.Load() == BUILDING);
+	size_t memoryBudget = s_memoryBudget.Load();
+	size_t memoryInUse = s_memoryInUse.Load();
+	do
+	{
+		if (tableBytes == 0 || tableBytes > memoryBudget || memoryInUse > memoryBudget - tableBytes)
+		{
+			// try again on a later use, when other tables may have been released
+			m_state.Store(COUNTING);
+			return false;
+		}
+	}
+	while (!s_memoryInUse.CompareExchange(memoryInUse, memoryInUse + tableBytes));
+	m_bytes = tableBytes;
+	return true;
+}
+
+void DL_AdaptivePrecomputation::Release()
+{
+	if (m_bytes != 0)
+	{
+		assert(s_memoryInUse.Load() >= m_bytes);
+		s_memoryInUse.FetchSub(m_bytes);
+		m_bytes = 0;
+	}
+}
+
+void SignaturePhaseTimer::Reset()
+{
+	for (unsigned int i=0; i<PHASE_COUNT; i++)
+		m_ticks[i] = 0;
+}
+
+double SignaturePhaseTimer::ElapsedTimeAsDouble(Phase phase) const
+{
+	return (double)CRYPTOPP_VC6_INT64 m_ticks[phase] / CRYPTOPP_VC6_INT64 m_timer.TicksPerSecond();
+}
+
 bool PK_DeterministicSignatureMessageEncodingMethod::VerifyMessageRepresentative(
 	HashTransformation &hash, HashIdentifier hashIdentifier, bool messageEmpty,
 	byte *representative, size_t representativeBitLength) const
@@ -74,12 +168,16 @@ size_t TF_SignerBase::SignAndRestart(RandomNumberGenerator &rng, PK_MessageAccum
 		throw PK_SignatureScheme::KeyTooShort();
 
 	SecByteBlock representative(MessageRepresentativeLength());
-	encoding.ComputeMessageRepresentative(rng, 
-		ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
-		ma.AccessHash(), id, ma.m_empty,
-		representative, MessageRepresentativeBitLength());
+	{
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::ENCODE);
+		encoding.ComputeMessageRepresentative(rng, 
+			ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
+			ma.AccessHash(), id, ma.m_empty,
+			representative, MessageRepresentativeBitLength());
+	}
 	ma.m_empty = true;
 
+	SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::KEY_OPERATION);
 	Integer r(representative, representative.size());
 	size_t signatureLength = SignatureLength();
 	GetTrapdoorFunctionInterface().CalculateRandomizedInverse(rng, r).Encode(signature, signatureLength);
@@ -96,7 +194,12 @@ void TF_VerifierBase::InputSignature(PK_MessageAccumulator &messageAccumulator,
 		throw PK_SignatureScheme::KeyTooShort();
 
 	ma.m_representative.New(MessageRepresentativeLength());
-	Integer x = GetTrapdoorFunctionInterface().ApplyFunction(Integer(signature, signatureLength));
+	Integer x;
+	{
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::KEY_OPERATION);
+		x = GetTrapdoorFunctionInterface().ApplyFunction(Integer(signature, signatureLength));
+	}
+	SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::DECODE);
 	if (x.BitCount() > MessageRepresentativeBitLength())
 		x = Integer::Zero();	// don't return false here to prevent timing attack
 	x.Encode(ma.m_representative, ma.m_representative.size());
@@ -111,12 +214,50 @@ bool TF_VerifierBase::VerifyAndRestart(PK_MessageAccumulator &messageAccumulator
 	if (MessageRepresentativeBitLength() < encoding.MinRepresentativeBitLength(id.second, ma.AccessHash().DigestSize()))
 		throw PK_SignatureScheme::KeyTooShort();
 
+	SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::ENCODE);
 	bool result = encoding.VerifyMessageRepresentative(
 		ma.AccessHash(), id, ma.m_empty, ma.m_representative, MessageRepresentativeBitLength());
 	ma.m_empty = true;
 	return result;
 }
 
+bool TF_VerifierBase::VerifyMessages(const Item *items, size_t count, bool *results) const
+{
+#ifdef CRYPTOPP_SCRATCH_ARENA
+	ScratchArena::Scope scope;
+#endif
+	HashIdentifier id = GetHashIdentifier();
+	const MessageEncodingInterface &encoding = GetMessageEncodingInterface();
+	std::auto_ptr<PK_MessageAccumulator> m(NewVerificationAccumulator());
+	PK_MessageAccumulatorBase &ma = static_cast<PK_MessageAccumulatorBase &>(*m);
+
+	if (MessageRepresentativeBitLength() < encoding.MinRepresentativeBitLength(id.second, ma.AccessHash().DigestSize()))
+		throw PK_SignatureScheme::KeyTooShort();
+
+	if (count == 0)
+		return true;
+
+	std::vector<Integer> x(count);
+	for (size_t i=0; i<count; i++)
+		x[i].Decode(items[i].signature, items[i].signatureLength);
+	GetTrapdoorFunctionInterface().ApplyFunctions(&x[0], &x[0], count);
+
+	bool pass = true;
+	ma.m_representative.New(MessageRepresentativeLength());
+	for (size_t i=0; i<count; i++)
+	{
+		if (x[i].BitCount() > MessageRepresentativeBitLength())
+			x[i] = Integer::Zero();
+		x[i].Encode(ma.m_representative, ma.m_representative.size());
+		ma.Update(items[i].message, items[i].messageLength);
+		results[i] = encoding.VerifyMessageRepresentative(
+			ma.AccessHash(), id, ma.m_empty, ma.m_representative, MessageRepresentativeBitLength());
+		ma.m_empty = true;
+		pass = pass && results[i];
+	}
+	return pass;
+}
+
 DecodingResult TF_VerifierBase::RecoverAndRestart(byte *recoveredMessage, PK_MessageAccumulator &messageAccumulator) const
 {
 	PK_MessageAccumulatorBase &ma = static_cast<PK_MessageAccumulatorBase &>(messageAccumulator);
@@ -37,7 +37,9 @@
 #include "eprecomp.h"
 #include "fips140.h"
 #include "argnames.h"
+#include "hrtimer.h"
 #include <memory>
+#include <vector>
 
 // VC60 workaround: this macro is defined in shlobj.h and conflicts with a template parameter used in this file
 #undef INTERFACE
@@ -73,6 +75,10 @@ public:
 	bool IsRandomized() const {return false;}
 
 	virtual Integer ApplyFunction(const Integer &x) const =0;
+	//! sets y[i] = ApplyFunction(x[i]) for i < count
+	/*! Functions that are faster on several inputs together than on one at a time override this. */
+	virtual void ApplyFunctions(Integer *y, const Integer *x, size_t count) const
+		{for (size_t i=0; i<count; i++) y[i] = ApplyFunction(x[i]);}
 };
 
 //! _
@@ -280,22 +286,70 @@ public:
 		byte *representative, size_t representativeBitLength) const;
 };
 
+//! accumulates the time a signer or verifier spends in each phase of its work
+/*! Attach one to a message accumulator with PK_MessageAccumulatorBase::SetPhaseTimer().
+	The phases are split the same way for signers and verifiers of every scheme:
+	HASH is time spent in Update(); ENCODE is finalizing the digest and computing the
+	message representative, or on TF verifiers checking the recovered one against it,
+	and on DL signers also mixing the representative into the RNG before drawing k;
+	KEY_OPERATION is the trapdoor function or group arithmetic; and DECODE is parsing
+	the signature and the output of the trapdoor function. */
+class CRYPTOPP_DLL SignaturePhaseTimer
+{
+public:
+	enum Phase {HASH = 0, ENCODE, KEY_OPERATION, DECODE, PHASE_COUNT};
+
+	SignaturePhaseTimer() {Reset();}
+
+	void Reset();
+	//! seconds spent in phase since the last Reset()
+	double ElapsedTimeAsDouble(Phase phase) const;
+
+	//! adds the time until it goes out of scope to phase, if timer is not NULL
+	class Scope
+	{
+	public:
+		Scope(SignaturePhaseTimer *timer, Phase phase)
+			: m_timer(timer), m_phase(phase) {if (m_timer) m_start = m_timer->m_timer.GetCurrentTimerValue();}
+		~Scope()
+			{if (m_timer) m_timer->m_ticks[m_phase] += m_timer->m_timer.GetCurrentTimerValue() - m_start;}
+
+	private:
+		SignaturePhaseTimer *m_timer;
+		Phase m_phase;
+		TimerWord m_start;
+	};
+
+private:
+	mutable Timer m_timer;
+	TimerWord m_ticks[PHASE_COUNT];
+};
+
 class CRYPTOPP_DLL CRYPTOPP_NO_VTABLE PK_MessageAccumulatorBase : public PK_MessageAccumulator
 {
 public:
-	PK_MessageAccumulatorBase() : m_empty(true) {}
+	PK_MessageAccumulatorBase() : m_empty(true), m_phaseTimer(NULL) {}
 
 	virtual HashTransformation & AccessHash() =0;
 
 	void Update(const byte *input, size_t length)
 	{
+		SignaturePhaseTimer::Scope scope(m_phaseTimer, SignaturePhaseTimer::HASH);
 		AccessHash().Update(input, length);
 		m_empty = m_empty && length == 0;
 	}
 
+	//! time the phases of signing or verifying with this accumulator, or stop timing if timer is NULL
+	/*! The timer is not owned by the accumulator and must outlive its use. */
+	void SetPhaseTimer(SignaturePhaseTimer *timer) {m_phaseTimer = timer;}
+	SignaturePhaseTimer * GetPhaseTimer() const {return m_phaseTimer;}
+
 	SecByteBlock m_recoverableMessage, m_representative, m_presignature, m_semisignature;
 	Integer m_k, m_s;
 	bool m_empty;
+
+private:
+	SignaturePhaseTimer *m_phaseTimer;
 };
 
 template <class HASH_ALGORITHM>
@@ -346,6 +400,20 @@ public:
 	void InputSignature(PK_MessageAccumulator &messageAccumulator, const byte *signature, size_t signatureLength) const;
 	bool VerifyAndRestart(PK_MessageAccumulator &messageAccumulator) const;
 	DecodingResult RecoverAndRestart(byte *recoveredMessage, PK_MessageAccumulator &recoveryAccumulator) const;
+
+	//! a message and its signature, for use with VerifyMessages()
+	struct Item
+	{
+		const byte *message;
+		size_t messageLength;
+		const byte *signature;
+		size_t signatureLength;
+	};
+
+	//! verify count message/signature pairs against this key
+	/*! results[i] is set to the outcome for items[i], and the return value is true iff all of them verified.
+		The trapdoor function is applied to all the signatures in one call to ApplyFunctions(). */
+	bool VerifyMessages(const Item *items, size_t count, bool *results) const;
 };
 
 // ********************************************************
@@ -583,6 +651,27 @@ public:
 		SimultaneousExponentiate(&result, base, &exponent, 1);
 		return result;
 	}
+	//! returns a reducer for GetSubgroupOrder(), for the arithmetic of signature algorithms
+	/*! The reducer is built whenever the subgroup order is set. */
+	const BarrettReducer & GetSubgroupOrderReducer() const
+	{
+		assert(m_subgroupOrderReducer.GetModulus() == GetSubgroupOrder());
+		return m_subgroupOrderReducer;
+	}
+	//! returns a random exponent in [1, GetSubgroupOrder()-1] for use as an ephemeral key
+	/*! 64 random bits more than the subgroup order has are reduced modulo the order, as in
+		appendix B.2.1 of FIPS 186-4, so the bias is below 2^-64 and no draw is rejected
+		except for a result of 0. */
+	Integer GenerateEphemeralExponent(RandomNumberGenerator &rng) const
+	{
+		const BarrettReducer &reducer = GetSubgroupOrderReducer();
+		const size_t bits = GetSubgroupOrder().BitCount() + 64;
+		Integer k;
+		do
+			k = reducer.Reduce(Integer(rng, bits));
+		while (k.IsZero());
+		return k;
+	}
 
 	virtual const DL_GroupPrecomputation<Element> & GetGroupPrecomputation() const =0;
 	virtual const DL_FixedBasePrecomputation<Element> & GetBasePrecomputation() const =0;
@@ -603,9 +692,12 @@ public:
 
 protected:
 	void ParametersChanged() {m_validationLevel = 0;}
+	// to be called by derived classes whenever they set the subgroup order
+	void SubgroupOrderChanged() {m_subgroupOrderReducer = BarrettReducer(GetSubgroupOrder()); ParametersChanged();}
 
 private:
 	mutable unsigned int m_validationLevel;
+	BarrettReducer m_subgroupOrderReducer;
 };
 
 //! _
@@ -834,6 +926,109 @@ public:
 	}
 };
 
+//! builds public element precomputation for DL public keys once they are used often
+/*! When the policy is on, a public key that has done ThresholdUses() exponentiations
+	with its public element builds tables of Storage() elements for its public element
+	and, unless its group parameters already have one, for its group's base, as
+	Precompute(Storage()) would, provided the tables built this way take no more than
+	MemoryBudget() bytes in total. The tables are kept apart from the key's own
+	precomputation and are only used once they are complete, so a key can be shared
+	between threads, each with an ArithmeticWorkspace, while the policy is on, provided
+	CRYPTOPP_CXX11_ATOMICS is defined.
+	Keys that were precomputed explicitly or whose precomputation was loaded are left
+	alone, as are keys with a subgroup order under MIN_SUBGROUP_ORDER_BITS bits, for
+	which exponentiating with the tables is slower than without. The policy is off by
+	default, and should be set before any keys are used. */
+class CRYPTOPP_DLL DL_AdaptivePrecomputation
+{
+public:
+	enum {MIN_SUBGROUP_ORDER_BITS = 160};
+
+	DL_AdaptivePrecomputation() : m_uses(0), m_bytes(0), m_state(COUNTING) {}
+	DL_AdaptivePrecomputation(const DL_AdaptivePrecomputation &other);
+	~DL_AdaptivePrecomputation() {Release();}
+	DL_AdaptivePrecomputation & operator=(const DL_AdaptivePrecomputation &other);
+
+	//! turn the policy on, or off if thresholdUses is 0
+	static void SetPolicy(unsigned int thresholdUses, size_t memoryBudget, unsigned int storage = 16);
+	static unsigned int ThresholdUses() {return s_thresholdUses.Load();}
+	static size_t MemoryBudget() {return s_memoryBudget.Load();}
+	static unsigned int Storage() {return s_storage.Load();}
+	//! bytes taken by the tables that are currently built
+	static size_t MemoryInUse() {return s_memoryInUse.Load();}
+
+	//! count a use, and return true if the caller should now build the tables, which no other caller will then do
+	bool CountUse();
+	//! claim tableBytes of the budget for the tables, and if there is not enough left, return false and go on counting
+	bool Reserve(size_t tableBytes);
+	//! the tables are complete, which lets all threads use them
+	void Publish() {m_state.Store(READY);}
+	//! building the tables failed, which gives back the budget and lets a later use try again
+	void Abandon() {Release(); m_state.Store(COUNTING);}
+	//! returns true if the tables can be used
+	bool IsReady() const {return m_state.Load() == READY;}
+	//! the key was precomputed by its owner
+	void SetExplicit() {Release(); m_state.Store(SETTLED);}
+	//! the key would not benefit from tables
+	void Decline() {m_state.Store(SETTLED);}
+	//! the public element changed, which discards any table
+	void Reset() {Release(); m_uses.Store(0); m_state.Store(COUNTING);}
+
+private:
+	enum State {COUNTING, BUILDING, READY, SETTLED};
+
+	void CopyState(const DL_AdaptivePrecomputation &other);
+	void Release();
+
+	static AtomicValue<unsigned int> s_thresholdUses, s_storage;
+	static AtomicValue<size_t> s_memoryBudget, s_memoryInUse;
+
+	AtomicValue<unsigned int> m_uses;
+	size_t m_bytes;		// only written by the caller that builds the tables, before it publishes them
+	AtomicValue<int> m_state;
+};
+
+//! DL_AdaptivePrecomputation together with the tables it builds
+/*! A copy only takes the tables once they are complete, so a key can be copied while
+	another thread builds them. */
+template <class PC>
+class DL_AdaptivePrecomputationTables : public DL_AdaptivePrecomputation
+{
+public:
+	DL_AdaptivePrecomputationTables() {}
+	DL_AdaptivePrecomputationTables(const DL_AdaptivePrecomputationTables<PC> &other)
+		: DL_AdaptivePrecomputation(other) {CopyTables(other);}
+	DL_AdaptivePrecomputationTables<PC> & operator=(const DL_AdaptivePrecomputationTables<PC> &other)
+	{
+		if (this != &other)
+		{
+			DL_AdaptivePrecomputation::operator=(other);
+			CopyTables(other);
+		}
+		return *this;
+	}
+
+	void SetExplicit() {DL_AdaptivePrecomputation::SetExplicit(); m_base = PC(); m_element = PC();}
+	void Reset() {DL_AdaptivePrecomputation::Reset(); m_base = PC(); m_element = PC();}
+	void Abandon() {DL_AdaptivePrecomputation::Abandon(); m_base = PC(); m_element = PC();}
+
+	//! the table of the group's base, left empty if the group parameters have their own
+	const PC & GetBaseTable() const {return m_base;}
+	PC & AccessBaseTable() {return m_base;}
+	//! the table of the public element
+	const PC & GetElementTable() const {return m_element;}
+	PC & AccessElementTable() {return m_element;}
+
+private:
+	void CopyTables(const DL_AdaptivePrecomputationTables<PC> &other)
+	{
+		m_base = IsReady() ? other.m_base : PC();
+		m_element = IsReady() ? other.m_element : PC();
+	}
+
+	PC m_base, m_element;
+};
+
 //! _
 template <class GP>
 class DL_PublicKeyImpl : public DL_PublicKey<typename GP::Element>, public DL_KeyImpl<X509PublicKey, GP>
@@ -865,12 +1060,14 @@ public:
 	{
 		AccessAbstractGroupParameters().Precompute(precomputationStorage);
 		AccessPublicPrecomputation().Precompute(GetAbstractGroupParameters().GetGroupPrecomputation(), GetAbstractGroupParameters().GetSubgroupOrder().BitCount(), precomputationStorage);
+		m_adaptive.SetExplicit();
 	}
 
 	void LoadPrecomputation(BufferedTransformation &storedPrecomputation)
 	{
 		AccessAbstractGroupParameters().LoadPrecomputation(storedPrecomputation);
 		AccessPublicPrecomputation().Load(GetAbstractGroupParameters().GetGroupPrecomputation(), storedPrecomputation);
+		m_adaptive.SetExplicit();
 	}
 
 	void SavePrecomputation(BufferedTransformation &storedPrecomputation) const
@@ -887,12 +1084,74 @@ public:
 	const DL_FixedBasePrecomputation<Element> & GetPublicPrecomputation() const {return m_ypc;}
 	DL_FixedBasePrecomputation<Element> & AccessPublicPrecomputation() {return m_ypc;}
 
+	void SetPublicElement(const Element &y)
+	{
+		m_adaptive.Reset();
+		DL_PublicKey<Element>::SetPublicElement(y);
+	}
+	Element ExponentiatePublicElement(const Integer &exponent) const
+	{
+		CountUse();
+		if (m_adaptive.IsReady())
+			return m_adaptive.GetElementTable().Exponentiate(GetAbstractGroupParameters().GetGroupPrecomputation(), exponent);
+		return DL_PublicKey<Element>::ExponentiatePublicElement(exponent);
+	}
+	Element CascadeExponentiateBaseAndPublicElement(const Integer &baseExp, const Integer &publicExp) const
+	{
+		CountUse();
+		if (m_adaptive.IsReady())
+		{
+			const DL_GroupParameters<Element> &params = GetAbstractGroupParameters();
+			const DL_FixedBasePrecomputation<Element> &baseTable = m_adaptive.GetBaseTable().IsInitialized()
+				? static_cast<const DL_FixedBasePrecomputation<Element> &>(m_adaptive.GetBaseTable()) : params.GetBasePrecomputation();
+			return baseTable.CascadeExponentiate(params.GetGroupPrecomputation(), baseExp, m_adaptive.GetElementTable(), publicExp);
+		}
+		return DL_PublicKey<Element>::CascadeExponentiateBaseAndPublicElement(baseExp, publicExp);
+	}
+
 	// non-inherited
 	bool operator==(const DL_PublicKeyImpl<GP> &rhs) const
 		{return this->GetGroupParameters() == rhs.GetGroupParameters() && this->GetPublicElement() == rhs.GetPublicElement();}
 
 private:
+	// see DL_AdaptivePrecomputation
+	void CountUse() const
+	{
+		if (m_adaptive.CountUse())
+		{
+			// the tables only pay off when both bases of CascadeExponentiateBaseAndPublicElement() have one,
+			// but a base table the group parameters already have is used as it is
+			const DL_GroupParameters<Element> &params = GetAbstractGroupParameters();
+			const DL_GroupPrecomputation<Element> &group = params.GetGroupPrecomputation();
+			unsigned int bits = params.GetSubgroupOrder().BitCount();
+			unsigned int storage = STDMIN(DL_AdaptivePrecomputation::Storage(), bits);
+			unsigned int tables = params.GetBasePrecomputation().IsPrecomputed() ? 1 : 2;
+			if (bits < DL_AdaptivePrecomputation::MIN_SUBGROUP_ORDER_BITS)
+				m_adaptive.Decline();
+			else if (m_adaptive.Reserve(tables * storage * params.GetEncodedElementSize(false)))
+			{
+				try
+				{
+					if (tables == 2)
+					{
+						m_adaptive.AccessBaseTable().SetBase(group, params.GetSubgroupGenerator());
+						m_adaptive.AccessBaseTable().Precompute(group, bits, storage);
+					}
+					m_adaptive.AccessElementTable().SetBase(group, this->GetPublicElement());
+					m_adaptive.AccessElementTable().Precompute(group, bits, storage);
+				}
+				catch (...)
+				{
+					m_adaptive.Abandon();
+					throw;
+				}
+				m_adaptive.Publish();
+			}
+		}
+	}
+
 	typename GP::BasePrecomputation m_ypc;
+	mutable DL_AdaptivePrecomputationTables<typename GP::BasePrecomputation> m_adaptive;
 };
 
 //! interface for Elgamal-like signature algorithms
@@ -902,6 +1161,18 @@ class CRYPTOPP_NO_VTABLE DL_ElgamalLikeSignatureAlgorithm
 public:
 	virtual void Sign(const DL_GroupParameters<T> &params, const Integer &privateKey, const Integer &k, const Integer &e, Integer &r, Integer &s) const =0;
 	virtual bool Verify(const DL_GroupParameters<T> &params, const DL_PublicKey<T> &publicKey, const Integer &e, const Integer &r, const Integer &s) const =0;
+	//! sign count representatives, with r[i] set on entry as for Sign() from the ephemeral key k[i]
+	virtual void SignBatch(const DL_GroupParameters<T> &params, const Integer &privateKey, size_t count, const Integer *k, const Integer *e, Integer *r, Integer *s) const
+	{
+		for (size_t i=0; i<count; i++)
+			Sign(params, privateKey, k[i], e[i], r[i], s[i]);
+	}
+	//! verify count signatures against the same public key, storing one result per signature
+	virtual void VerifyBatch(const DL_GroupParameters<T> &params, const DL_PublicKey<T> &publicKey, size_t count, const Integer *e, const Integer *r, const Integer *s, bool *results) const
+	{
+		for (size_t i=0; i<count; i++)
+			results[i] = Verify(params, publicKey, e[i], r[i], s[i]);
+	}
 	virtual Integer RecoverPresignature(const DL_GroupParameters<T> &params, const DL_PublicKey<T> &publicKey, const Integer &r, const Integer &s) const
 		{throw NotImplemented("DL_ElgamalLikeSignatureAlgorithm: this signature scheme does not support message recovery");}
 	virtual size_t RLen(const DL_GroupParameters<T> &params) const
@@ -1024,22 +1295,10 @@ public:
 		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
 		const DL_PrivateKey<T> &key = this->GetKeyInterface();
 
-		SecByteBlock representative(this->MessageRepresentativeLength());
-		this->GetMessageEncodingInterface().ComputeMessageRepresentative(
-			rng, 
-			ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
-			ma.AccessHash(), this->GetHashIdentifier(), ma.m_empty, 
-			representative, this->MessageRepresentativeBitLength());
-		ma.m_empty = true;
-		Integer e(representative, representative.size());
+		Integer e, k, r, s;
+		BeginSignature(rng, ma, e, k, r);
 
-		// hash message digest into random number k to prevent reusing the same k on a different messages
-		// after virtual machine rollback
-		if (rng.CanIncorporateEntropy())
-			rng.IncorporateEntropy(representative, representative.size());
-		Integer k(rng, 1, params.GetSubgroupOrder()-1);
-		Integer r, s;
-		r = params.ConvertElementToInteger(params.ExponentiateBase(k));
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::KEY_OPERATION);
 		alg.Sign(params, key.GetPrivateExponent(), k, e, r, s);
 
 		/*
@@ -1051,9 +1310,7 @@ public:
 		alg.Sign(params, key.GetPrivateExponent(), ma.m_k, e, r, s);
 		*/
 
-		size_t rLen = alg.RLen(params);
-		r.Encode(signature, rLen);
-		s.Encode(signature+rLen, alg.SLen(params));
+		EncodeSignature(r, s, signature);
 
 		if (restart)
 			RestartMessageAccumulator(rng, ma);
@@ -1061,7 +1318,84 @@ public:
 		return this->SignatureLength();
 	}
 
+	//! a message for use with SignMessages()
+	struct Item
+	{
+		const byte *message;
+		size_t messageLength;
+	};
+
+	//! sign count messages with this key, writing the signatures one after another to signatures
+	/*! Each signature takes SignatureLength() bytes. Work that does not depend on the individual
+		message, such as the inversions of the ephemeral keys needed by DSA and ECDSA, is shared
+		across the batch. */
+	void SignMessages(RandomNumberGenerator &rng, const Item *items, size_t count, byte *signatures) const
+	{
+#ifdef CRYPTOPP_SCRATCH_ARENA
+		ScratchArena::Scope scope;
+#endif
+		this->GetMaterial().DoQuickSanityCheck();
+
+		if (count == 0)
+			return;
+
+		const DL_ElgamalLikeSignatureAlgorithm<T> &alg = this->GetSignatureAlgorithm();
+		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
+		const DL_PrivateKey<T> &key = this->GetKeyInterface();
+
+		std::vector<Integer> k(count), e(count), r(count), s(count);
+		std::auto_ptr<PK_MessageAccumulator> m(this->NewSignatureAccumulator(rng));
+		PK_MessageAccumulatorBase &ma = static_cast<PK_MessageAccumulatorBase &>(*m);
+
+		for (size_t i=0; i<count; i++)
+		{
+			ma.Update(items[i].message, items[i].messageLength);
+			BeginSignature(rng, ma, e[i], k[i], r[i]);
+		}
+
+		alg.SignBatch(params, key.GetPrivateExponent(), count, &k[0], &e[0], &r[0], &s[0]);
+
+		for (size_t i=0; i<count; i++)
+			EncodeSignature(r[i], s[i], signatures + i*this->SignatureLength());
+	}
+
 protected:
+	// computes the representative e of the message in ma and then the ephemeral key k and r from it,
+	// everything a signature needs before the private key is used
+	void BeginSignature(RandomNumberGenerator &rng, PK_MessageAccumulatorBase &ma, Integer &e, Integer &k, Integer &r) const
+	{
+		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
+
+		SecByteBlock representative(this->MessageRepresentativeLength());
+		{
+			SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::ENCODE);
+			this->GetMessageEncodingInterface().ComputeMessageRepresentative(
+				rng, 
+				ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
+				ma.AccessHash(), this->GetHashIdentifier(), ma.m_empty, 
+				representative, this->MessageRepresentativeBitLength());
+			// hash message digest into random number k to prevent reusing the same k on a different messages
+			// after virtual machine rollback
+			if (rng.CanIncorporateEntropy())
+				rng.IncorporateEntropy(representative, representative.size());
+		}
+		ma.m_empty = true;
+		e.Decode(representative, representative.size());
+
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::KEY_OPERATION);
+		k = params.GenerateEphemeralExponent(rng);
+		r = params.ConvertElementToInteger(params.ExponentiateBase(k));
+	}
+
+	void EncodeSignature(const Integer &r, const Integer &s, byte *signature) const
+	{
+		const DL_ElgamalLikeSignatureAlgorithm<T> &alg = this->GetSignatureAlgorithm();
+		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
+		size_t rLen = alg.RLen(params);
+		r.Encode(signature, rLen);
+		s.Encode(signature+rLen, alg.SLen(params));
+	}
+
 	void RestartMessageAccumulator(RandomNumberGenerator &rng, PK_MessageAccumulatorBase &ma) const
 	{
 		// k needs to be generated before hashing for signature schemes with recovery
@@ -1089,6 +1423,7 @@ public:
 		const DL_ElgamalLikeSignatureAlgorithm<T> &alg = this->GetSignatureAlgorithm();
 		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
 
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::DECODE);
 		size_t rLen = alg.RLen(params);
 		ma.m_semisignature.Assign(signature, rLen);
 		ma.m_s.Decode(signature+rLen, alg.SLen(params));
@@ -1105,17 +1440,68 @@ public:
 		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
 		const DL_PublicKey<T> &key = this->GetKeyInterface();
 
-		SecByteBlock representative(this->MessageRepresentativeLength());
-		this->GetMessageEncodingInterface().ComputeMessageRepresentative(NullRNG(), ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
-			ma.AccessHash(), this->GetHashIdentifier(), ma.m_empty,
-			representative, this->MessageRepresentativeBitLength());
-		ma.m_empty = true;
-		Integer e(representative, representative.size());
-
-		Integer r(ma.m_semisignature, ma.m_semisignature.size());
+		Integer e = ComputeRepresentativeAndRestart(ma);
+		Integer r;
+		{
+			SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::DECODE);
+			r.Decode(ma.m_semisignature, ma.m_semisignature.size());
+		}
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::KEY_OPERATION);
 		return alg.Verify(params, key, e, r, ma.m_s);
 	}
 
+	//! a message and its signature, for use with VerifyMessages()
+	struct Item
+	{
+		const byte *message;
+		size_t messageLength;
+		const byte *signature;
+		size_t signatureLength;
+	};
+
+	//! verify count message/signature pairs against this key
+	/*! results[i] is set to the outcome for items[i], and the return value is true iff all of them verified.
+		Work that does not depend on the individual signature, such as the modular inversions
+		needed by DSA and ECDSA, is shared across the batch. */
+	bool VerifyMessages(const Item *items, size_t count, bool *results) const
+	{
+#ifdef CRYPTOPP_SCRATCH_ARENA
+		ScratchArena::Scope scope;
+#endif
+		this->GetMaterial().DoQuickSanityCheck();
+
+		const DL_ElgamalLikeSignatureAlgorithm<T> &alg = this->GetSignatureAlgorithm();
+		const DL_GroupParameters<T> &params = this->GetAbstractGroupParameters();
+		const DL_PublicKey<T> &key = this->GetKeyInterface();
+		const size_t signatureLength = this->SignatureLength();
+
+		std::vector<Integer> e(count), r(count), s(count);
+		std::auto_ptr<PK_MessageAccumulator> m(this->NewVerificationAccumulator());
+		PK_MessageAccumulatorBase &ma = static_cast<PK_MessageAccumulatorBase &>(*m);
+
+		for (size_t i=0; i<count; i++)
+		{
+			// a zero r is rejected by every Verify(), so use it to mark malformed signatures
+			if (items[i].signatureLength != signatureLength)
+				continue;
+			InputSignature(ma, items[i].signature, items[i].signatureLength);
+			ma.Update(items[i].message, items[i].messageLength);
+			e[i] = ComputeRepresentativeAndRestart(ma);
+			r[i].Decode(ma.m_semisignature, ma.m_semisignature.size());
+			s[i] = ma.m_s;
+		}
+
+		if (count == 0)
+			return true;
+
+		alg.VerifyBatch(params, key, count, &e[0], &r[0], &s[0], results);
+
+		bool pass = true;
+		for (size_t i=0; i<count; i++)
+			pass = pass && results[i];
+		return pass;
+	}
+
 	DecodingResult RecoverAndRestart(byte *recoveredMessage, PK_MessageAccumulator &messageAccumulator) const
 	{
 		this->GetMaterial().DoQuickSanityCheck();
@@ -1144,6 +1530,18 @@ public:
 			ma.m_semisignature, ma.m_semisignature.size(),
 			recoveredMessage);
 	}
+
+protected:
+	Integer ComputeRepresentativeAndRestart(PK_MessageAccumulatorBase &ma) const
+	{
+		SignaturePhaseTimer::Scope scope(ma.GetPhaseTimer(), SignaturePhaseTimer::ENCODE);
+		SecByteBlock representative(this->MessageRepresentativeLength());
+		this->GetMessageEncodingInterface().ComputeMessageRepresentative(NullRNG(), ma.m_recoverableMessage, ma.m_recoverableMessage.size(), 
+			ma.AccessHash(), this->GetHashIdentifier(), ma.m_empty,
+			representative, this->MessageRepresentativeBitLength());
+		ma.m_empty = true;
+		return Integer(representative, representative.size());
+	}
 };
 
 //! _
@@ -30,8 +30,22 @@ void RabinFunction::DEREncode(BufferedTransformation &bt) const
 Integer RabinFunction::ApplyFunction(const Integer &in) const
 {
 	DoQuickSanityCheck();
+	return CompleteFunction(in, in.Squared()%m_n);
+}
 
-	Integer out = in.Squared()%m_n;
+void RabinFunction::ApplyFunctions(Integer *y, const Integer *x, size_t count) const
+{
+	DoQuickSanityCheck();
+	if (count == 0)
+		return;
+	std::vector<Integer> squares(count);
+	a_exp_b_mod_c(&squares[0], x, count, Integer::Two(), m_n);
+	for (size_t i=0; i<count; i++)
+		y[i] = CompleteFunction(x[i], squares[i]);
+}
+
+Integer RabinFunction::CompleteFunction(const Integer &in, Integer out) const
+{
 	if (in.IsOdd())
 		out = out*m_r%m_n;
 	if (Jacobi(in, m_n)==-1)
@@ -111,6 +125,7 @@ void InvertibleRabinFunction::GenerateRandom(RandomNumberGenerator &rng, const N
 
 	m_n = m_p * m_q;
 	m_u = m_q.InverseMod(m_p);
+	PrepareArithmetic();
 }
 
 void InvertibleRabinFunction::BERDecode(BufferedTransformation &bt)
@@ -123,6 +138,7 @@ void InvertibleRabinFunction::BERDecode(BufferedTransformation &bt)
 	m_q.BERDecode(seq);
 	m_u.BERDecode(seq);
 	seq.MessageEnd();
+	PrepareArithmetic();
 }
 
 void InvertibleRabinFunction::DEREncode(BufferedTransformation &bt) const
@@ -140,39 +156,46 @@ void InvertibleRabinFunction::DEREncode(BufferedTransformation &bt) const
 Integer InvertibleRabinFunction::CalculateInverse(RandomNumberGenerator &rng, const Integer &in) const
 {
 	DoQuickSanityCheck();
-
-	ModularArithmetic modn(m_n);
-	Integer r(rng, Integer::One(), m_n - Integer::One());
-	r = modn.Square(r);
-	Integer r2 = modn.Square(r);
-	Integer c = modn.Multiply(in, r2);		// blind
-
-	Integer cp=c%m_p, cq=c%m_q;
-
-	int jp = Jacobi(cp, m_p);
-	int jq = Jacobi(cq, m_q);
-
+	member_ptr<MontgomeryRepresentation> localN, localP, localQ;
+	const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, localN), &mrp = m_mrp.Get(m_p, localP), &mrq = m_mrq.Get(m_q, localQ);
+
+	Integer r, rInv;
+	do {	// do this in a loop for people using small numbers for testing
+		r.Randomize(rng, Integer::One(), m_n - Integer::One());
+		rInv = r.InverseMod(m_n);
+	} while (rInv.IsZero());
+	r = mrn.ConvertIn(r);
+	r = mrn.Square(r);
+	Integer r2 = mrn.Square(r);
+	Integer c = mrn.Multiply(r2, in%m_n);	// blind; a product of Montgomery and ordinary forms is ordinary
+
+	int jp, jq;
+	Integer cp = ModularSquareRoot(mrp, c%m_p, jp);
+	Integer cq = ModularSquareRoot(mrq, c%m_q, jq);
+
+	// the roots of c*r^-1 and c*s^-1 are those of c times the cached roots of r^-1 and s^-1
+	member_ptr<PrimeRoots> localRootsP, localRootsQ;
+	const PrimeRoots &rootsP = GetRoots(m_mrp, m_p, m_rootsP, localRootsP), &rootsQ = GetRoots(m_mrq, m_q, m_rootsQ, localRootsQ);
 	if (jq==-1)
 	{
-		cp = cp*EuclideanMultiplicativeInverse(m_r, m_p)%m_p;
-		cq = cq*EuclideanMultiplicativeInverse(m_r, m_q)%m_q;
+		cp = mrp.Multiply(cp, rootsP.rootRInv);
+		cq = mrq.Multiply(cq, rootsQ.rootRInv);
 	}
 
 	if (jp==-1)
 	{
-		cp = cp*EuclideanMultiplicativeInverse(m_s, m_p)%m_p;
-		cq = cq*EuclideanMultiplicativeInverse(m_s, m_q)%m_q;
+		cp = mrp.Multiply(cp, rootsP.rootSInv);
+		cq = mrq.Multiply(cq, rootsQ.rootSInv);
 	}
 
-	cp = ModularSquareRoot(cp, m_p);
-	cq = ModularSquareRoot(cq, m_q);
-
 	if (jp==-1)
 		cp = m_p-cp;
 
 	Integer out = CRT(cq, m_q, cp, m_p, m_u);
 
-	out = modn.Divide(out, r);	// unblind
+	rInv = mrn.ConvertIn(rInv);
+	rInv = mrn.Square(rInv);
+	out = mrn.Multiply(rInv, out);	// unblind
 
 	if ((jq==-1 && out.IsEven()) || (jq==1 && out.IsOdd()))
 		out = m_n-out;
@@ -180,6 +203,48 @@ Integer InvertibleRabinFunction::CalculateInverse(RandomNumberGenerator &rng, co
 	return out;
 }
 
+void InvertibleRabinFunction::PrepareArithmetic()
+{
+	m_mrn.Set(m_n);
+	PreparePrime(m_mrp, m_p, m_rootsP);
+	PreparePrime(m_mrq, m_q, m_rootsQ);
+}
+
+void InvertibleRabinFunction::PreparePrime(CachedMontgomeryRepresentation &mr, const Integer &p, PrimeRoots &roots) const
+{
+	mr.Set(p);
+	ComputeRoots(mr, p, roots);
+}
+
+void InvertibleRabinFunction::ComputeRoots(const CachedMontgomeryRepresentation &mr, const Integer &p, PrimeRoots &roots) const
+{
+	roots.p = p;
+	roots.r = m_r;
+	roots.s = m_s;
+	if (p <= Integer::One() || p%4 != 3)
+	{
+		roots.rootRInv = roots.rootSInv = Integer::Zero();	// not a valid key, which Validate() reports
+		return;
+	}
+
+	member_ptr<MontgomeryRepresentation> local;
+	const MontgomeryRepresentation &mrp = mr.Get(p, local);
+	Integer e = (p+1) >> 2;
+	roots.rootRInv = mrp.ConvertIn(a_exp_b_mod_c(m_r.InverseMod(p), e, p));
+	roots.rootSInv = mrp.ConvertIn(a_exp_b_mod_c(m_s.InverseMod(p), e, p));
+}
+
+const InvertibleRabinFunction::PrimeRoots & InvertibleRabinFunction::GetRoots(const CachedMontgomeryRepresentation &mr, const Integer &p, const PrimeRoots &roots, member_ptr<PrimeRoots> &local) const
+{
+	if (roots.ComputedFrom(p, m_r, m_s))
+		return roots;
+
+	// r or s was changed through RabinFunction, whose setters this class cannot see
+	local.reset(new PrimeRoots);
+	ComputeRoots(mr, p, *local);
+	return *local;
+}
+
 bool InvertibleRabinFunction::Validate(RandomNumberGenerator &rng, unsigned int level) const
 {
 	bool pass = RabinFunction::Validate(rng, level);
@@ -211,11 +276,13 @@ bool InvertibleRabinFunction::GetVoidValue(const char *name, const std::type_inf
 
 void InvertibleRabinFunction::AssignFrom(const NameValuePairs &source)
 {
+	// RabinFunction::AssignFrom() sets n, r and s before SetPrime1() and SetPrime2() use them
 	AssignFromHelper<RabinFunction>(this, source)
 		CRYPTOPP_SET_FUNCTION_ENTRY(Prime1)
 		CRYPTOPP_SET_FUNCTION_ENTRY(Prime2)
 		CRYPTOPP_SET_FUNCTION_ENTRY(MultiplicativeInverseOfPrime2ModPrime1)
 		;
+	m_mrn.Set(m_n);
 }
 
 NAMESPACE_END
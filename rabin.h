@@ -23,6 +23,7 @@ public:
 	void DEREncode(BufferedTransformation &bt) const;
 
 	Integer ApplyFunction(const Integer &x) const;
+	void ApplyFunctions(Integer *y, const Integer *x, size_t count) const;
 	Integer PreimageBound() const {return m_n;}
 	Integer ImageBound() const {return m_n;}
 
@@ -39,6 +40,9 @@ public:
 	void SetQuadraticResidueModPrime2(const Integer &s) {m_s = s;}
 
 protected:
+	// maps the square of the input mod n to the function value
+	Integer CompleteFunction(const Integer &in, Integer out) const;
+
 	Integer m_n, m_r, m_s;
 };
 
@@ -50,7 +54,7 @@ class InvertibleRabinFunction : public RabinFunction, public TrapdoorFunctionInv
 public:
 	void Initialize(const Integer &n, const Integer &r, const Integer &s,
 							const Integer &p, const Integer &q, const Integer &u)
-		{m_n = n; m_r = r; m_s = s; m_p = p; m_q = q; m_u = u;}
+		{m_n = n; m_r = r; m_s = s; m_p = p; m_q = q; m_u = u; PrepareArithmetic();}
 	void Initialize(RandomNumberGenerator &rng, unsigned int keybits)
 		{GenerateRandomWithKeySize(rng, keybits);}
 
@@ -69,12 +73,36 @@ public:
 	const Integer& GetPrime2() const {return m_q;}
 	const Integer& GetMultiplicativeInverseOfPrime2ModPrime1() const {return m_u;}
 
-	void SetPrime1(const Integer &p) {m_p = p;}
-	void SetPrime2(const Integer &q) {m_q = q;}
+	// these hide the setters of RabinFunction so that the values derived from the key stay current
+	void SetModulus(const Integer &n) {m_n = n; m_mrn.Set(m_n);}
+	void SetQuadraticResidueModPrime1(const Integer &r) {m_r = r; PrepareArithmetic();}
+	void SetQuadraticResidueModPrime2(const Integer &s) {m_s = s; PrepareArithmetic();}
+	void SetPrime1(const Integer &p) {m_p = p; PreparePrime(m_mrp, m_p, m_rootsP);}
+	void SetPrime2(const Integer &q) {m_q = q; PreparePrime(m_mrq, m_q, m_rootsQ);}
 	void SetMultiplicativeInverseOfPrime2ModPrime1(const Integer &u) {m_u = u;}
 
 protected:
+	// (r^-1)^((p+1)/4) and (s^-1)^((p+1)/4) mod a prime p of the key, in Montgomery form,
+	// and the p, r and s they were computed from
+	struct PrimeRoots
+	{
+		bool ComputedFrom(const Integer &p0, const Integer &r0, const Integer &s0) const
+			{return p == p0 && r == r0 && s == s0;}
+
+		Integer p, r, s, rootRInv, rootSInv;
+	};
+
+	void PrepareArithmetic();
+	void PreparePrime(CachedMontgomeryRepresentation &mr, const Integer &p, PrimeRoots &roots) const;
+	void ComputeRoots(const CachedMontgomeryRepresentation &mr, const Integer &p, PrimeRoots &roots) const;
+	const PrimeRoots & GetRoots(const CachedMontgomeryRepresentation &mr, const Integer &p, const PrimeRoots &roots, member_ptr<PrimeRoots> &local) const;
+
 	Integer m_p, m_q, m_u;
+	// Montgomery arithmetic mod n, p and q, kept like that of RSA keys (see RSAFunction::m_mrn)
+	CachedMontgomeryRepresentation m_mrn, m_mrp, m_mrq;
+	// computed again by every function of this class that changes p, q, r or s; the setters of
+	// RabinFunction are not virtual, so CalculateInverse() still checks that they match the key
+	PrimeRoots m_rootsP, m_rootsQ;
 };
 
 //! Rabin
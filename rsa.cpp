@@ -51,6 +51,7 @@ void RSAFunction::BERDecodePublicKey(BufferedTransformation &bt, bool, size_t)
 		m_n.BERDecode(seq);
 		m_e.BERDecode(seq);
 	seq.MessageEnd();
+	m_mrn.Set(m_n);
 }
 
 void RSAFunction::DEREncodePublicKey(BufferedTransformation &bt) const
@@ -64,7 +65,15 @@ void RSAFunction::DEREncodePublicKey(BufferedTransformation &bt) const
 Integer RSAFunction::ApplyFunction(const Integer &x) const
 {
 	DoQuickSanityCheck();
-	return a_exp_b_mod_c(x, m_e, m_n);
+	SlotPool<RSAArithmetic>::Borrowed arithmetic(m_arithmetic);
+	const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, arithmetic->mrn);
+	return mrn.ConvertOut(mrn.Exponentiate(mrn.ConvertIn(x), m_e));
+}
+
+void RSAFunction::ApplyFunctions(Integer *y, const Integer *x, size_t count) const
+{
+	DoQuickSanityCheck();
+	a_exp_b_mod_c(y, x, count, m_e, m_n);
 }
 
 bool RSAFunction::Validate(RandomNumberGenerator &rng, unsigned int level) const
@@ -114,19 +123,64 @@ void InvertibleRSAFunction::GenerateRandom(RandomNumberGenerator &rng, const Nam
 	if (m_e < 3 || m_e.IsEven())
 		throw InvalidArgument("InvertibleRSAFunction: invalid public exponent");
 
+	int primeCount = 2;
+	alg.GetIntValue(Name::PrimeCount(), primeCount);
+
+	if (primeCount < 2)
+		throw InvalidArgument("InvertibleRSAFunction: invalid prime count");
+	if (modulusSize < 16*primeCount)
+		throw InvalidArgument("InvertibleRSAFunction: specified modulus size is too small for the prime count");
+
 	RSAPrimeSelector selector(m_e);
-	AlgorithmParameters primeParam = MakeParametersForTwoPrimesOfEqualSize(modulusSize)
-		(Name::PointerToPrimeSelector(), selector.GetSelectorPointer());
-	m_p.GenerateRandom(rng, primeParam);
-	m_q.GenerateRandom(rng, primeParam);
+	m_otherPrimes.clear();
+	if (primeCount == 2)
+	{
+		AlgorithmParameters primeParam = MakeParametersForTwoPrimesOfEqualSize(modulusSize)
+			(Name::PointerToPrimeSelector(), selector.GetSelectorPointer());
+		m_p.GenerateRandom(rng, primeParam);
+		m_q.GenerateRandom(rng, primeParam);
+	}
+	else
+	{
+		// all primes but the last have the top two of their primeBits bits set, and the last one
+		// is chosen so that the product of all of them has exactly modulusSize bits
+		unsigned int primeBits = modulusSize / primeCount;
+		AlgorithmParameters primeParam = MakeParameters("RandomNumberType", Integer::PRIME)
+			("Min", Integer(3) << (primeBits-2))("Max", Integer::Power2(primeBits)-1)
+			(Name::PointerToPrimeSelector(), selector.GetSelectorPointer());
+
+		std::vector<Integer> primes;
+		Integer product = Integer::One();
+		while (primes.size() < (unsigned int)primeCount-1)
+		{
+			Integer r;
+			r.GenerateRandom(rng, primeParam);
+			if (std::find(primes.begin(), primes.end(), r) == primes.end())
+			{
+				primes.push_back(r);
+				product *= r;
+			}
+		}
 
-	m_d = m_e.InverseMod(LCM(m_p-1, m_q-1));
-	assert(m_d.IsPositive());
+		AlgorithmParameters lastParam = MakeParameters("RandomNumberType", Integer::PRIME)
+			("Min", (Integer::Power2(modulusSize-1) + product - 1) / product)
+			("Max", (Integer::Power2(modulusSize) - 1) / product)
+			(Name::PointerToPrimeSelector(), selector.GetSelectorPointer());
+		Integer r;
+		do
+			r.GenerateRandom(rng, lastParam);
+		while (std::find(primes.begin(), primes.end(), r) != primes.end());
+		primes.push_back(r);
+
+		m_p = primes[0];
+		m_q = primes[1];
+		m_otherPrimes.resize(primeCount-2);
+		for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+			m_otherPrimes[i].prime = primes[i+2];
+	}
 
-	m_dp = m_d % (m_p-1);
-	m_dq = m_d % (m_q-1);
-	m_n = m_p * m_q;
-	m_u = m_q.InverseMod(m_p);
+	ComputePrivateValues();
+	PrepareArithmetic();
 
 	if (FIPS_140_2_ComplianceEnabled())
 	{
@@ -140,9 +194,32 @@ void InvertibleRSAFunction::GenerateRandom(RandomNumberGenerator &rng, const Nam
 	}
 }
 
-void InvertibleRSAFunction::Initialize(RandomNumberGenerator &rng, unsigned int keybits, const Integer &e)
+void InvertibleRSAFunction::Initialize(RandomNumberGenerator &rng, unsigned int keybits, const Integer &e, unsigned int primeCount)
+{
+	GenerateRandom(rng, MakeParameters(Name::ModulusSize(), (int)keybits)(Name::PublicExponent(), e+e.IsEven())(Name::PrimeCount(), (int)primeCount));
+}
+
+// computes n, d and the CRT values from e, p, q and the other primes
+void InvertibleRSAFunction::ComputePrivateValues()
 {
-	GenerateRandom(rng, MakeParameters(Name::ModulusSize(), (int)keybits)(Name::PublicExponent(), e+e.IsEven()));
+	m_n = m_p * m_q;
+	Integer lambda = LCM(m_p-1, m_q-1);
+	for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+	{
+		const Integer &r = m_otherPrimes[i].prime;
+		m_otherPrimes[i].coefficient = m_n.InverseMod(r);
+		m_n *= r;
+		lambda = LCM(lambda, r-1);
+	}
+
+	m_d = m_e.InverseMod(lambda);
+	assert(m_d.IsPositive());
+
+	m_dp = m_d % (m_p-1);
+	m_dq = m_d % (m_q-1);
+	m_u = m_q.InverseMod(m_p);
+	for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+		m_otherPrimes[i].exponent = m_d % (m_otherPrimes[i].prime-1);
 }
 
 void InvertibleRSAFunction::Initialize(const Integer &n, const Integer &e, const Integer &d)
@@ -153,6 +230,8 @@ void InvertibleRSAFunction::Initialize(const Integer &n, const Integer &e, const
 	m_n = n;
 	m_e = e;
 	m_d = d;
+	m_otherPrimes.clear();
+	m_mrOther.clear();
 
 	Integer r = --(d*e);
 	unsigned int s = 0;
@@ -180,6 +259,7 @@ void InvertibleRSAFunction::Initialize(const Integer &n, const Integer &e, const
 				m_dp = m_d % (m_p-1);
 				m_dq = m_d % (m_q-1);
 				m_u = m_q.InverseMod(m_p);
+				PrepareArithmetic();
 				return;
 			}
 			if (++j == s)
@@ -193,7 +273,7 @@ void InvertibleRSAFunction::BERDecodePrivateKey(BufferedTransformation &bt, bool
 {
 	BERSequenceDecoder privateKey(bt);
 		word32 version;
-		BERDecodeUnsigned<word32>(privateKey, version, INTEGER, 0, 0);	// check version
+		BERDecodeUnsigned<word32>(privateKey, version, INTEGER, 0, 1);	// check version
 		m_n.BERDecode(privateKey);
 		m_e.BERDecode(privateKey);
 		m_d.BERDecode(privateKey);
@@ -202,13 +282,33 @@ void InvertibleRSAFunction::BERDecodePrivateKey(BufferedTransformation &bt, bool
 		m_dp.BERDecode(privateKey);
 		m_dq.BERDecode(privateKey);
 		m_u.BERDecode(privateKey);
+		OtherPrimeInfos otherPrimes;	// decoded apart so that an error leaves m_otherPrimes as m_mrOther expects
+		if (version == 1)	// multi-prime key, followed by otherPrimeInfos
+		{
+			BERSequenceDecoder otherPrimeInfos(privateKey);
+				while (!otherPrimeInfos.EndReached())
+				{
+					OtherPrimeInfo info;
+					BERSequenceDecoder otherPrimeInfo(otherPrimeInfos);
+						info.prime.BERDecode(otherPrimeInfo);
+						info.exponent.BERDecode(otherPrimeInfo);
+						info.coefficient.BERDecode(otherPrimeInfo);
+					otherPrimeInfo.MessageEnd();
+					otherPrimes.push_back(info);
+				}
+			otherPrimeInfos.MessageEnd();
+			if (otherPrimes.empty())
+				BERDecodeError();
+		}
 	privateKey.MessageEnd();
+	m_otherPrimes.swap(otherPrimes);
+	PrepareArithmetic();
 }
 
 void InvertibleRSAFunction::DEREncodePrivateKey(BufferedTransformation &bt) const
 {
 	DERSequenceEncoder privateKey(bt);
-		DEREncodeUnsigned<word32>(privateKey, 0);	// version
+		DEREncodeUnsigned<word32>(privateKey, m_otherPrimes.empty() ? 0 : 1);	// version
 		m_n.DEREncode(privateKey);
 		m_e.DEREncode(privateKey);
 		m_d.DEREncode(privateKey);
@@ -217,29 +317,149 @@ void InvertibleRSAFunction::DEREncodePrivateKey(BufferedTransformation &bt) cons
 		m_dp.DEREncode(privateKey);
 		m_dq.DEREncode(privateKey);
 		m_u.DEREncode(privateKey);
+		if (!m_otherPrimes.empty())
+		{
+			DERSequenceEncoder otherPrimeInfos(privateKey);
+				for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+				{
+					DERSequenceEncoder otherPrimeInfo(otherPrimeInfos);
+						m_otherPrimes[i].prime.DEREncode(otherPrimeInfo);
+						m_otherPrimes[i].exponent.DEREncode(otherPrimeInfo);
+						m_otherPrimes[i].coefficient.DEREncode(otherPrimeInfo);
+					otherPrimeInfo.MessageEnd();
+				}
+			otherPrimeInfos.MessageEnd();
+		}
 	privateKey.MessageEnd();
 }
 
+void RSABlindingFactors::Next(RandomNumberGenerator &rng, const MontgomeryRepresentation &mrn, const Integer &e, Integer &blind, Integer &unblind)
+{
+	const Integer &n = mrn.GetModulus();
+	if (m_uses == 0 || m_uses >= REFRESH_INTERVAL || m_n != n || m_e != e)
+	{
+		Integer r, rInv;
+		do {	// do this in a loop for people using small numbers for testing
+			r.Randomize(rng, Integer::One(), n - Integer::One());
+			rInv = r.InverseMod(n);
+		} while (rInv.IsZero());
+		m_blind = mrn.Exponentiate(mrn.ConvertIn(r), e);
+		m_unblind = mrn.ConvertIn(rInv);
+		m_n = n;
+		m_e = e;
+		m_uses = 0;
+	}
+	else
+	{
+		m_blind = mrn.Square(m_blind);
+		m_unblind = mrn.Square(m_unblind);
+	}
+
+	m_uses++;
+	blind = m_blind;
+	unblind = m_unblind;
+}
+
+// raises a, in Montgomery form, to e from left to right, which for the usual public exponents
+// such as 17 or 65537 is the shortest chain, without the table of a windowed exponentiation
+static Integer ExponentiateByPublicExponent(const MontgomeryRepresentation &mr, const Integer &a, const Integer &e)
+{
+	Integer result = a;
+	for (unsigned int i=e.BitCount()-1; i>0; i--)
+	{
+		result = mr.Square(result);
+		if (e.GetBit(i-1))
+			result = mr.Multiply(result, a);
+	}
+	return result;
+}
+
+// checks y^e = x modulo the prime of mr
+static bool IsPreimageModPrime(const MontgomeryRepresentation &mr, const Integer &y, const Integer &x, const Integer &e)
+{
+	const Integer &r = mr.GetModulus();
+	return mr.ConvertOut(ExponentiateByPublicExponent(mr, mr.ConvertIn(y % r), e)) == x % r;
+}
+
 Integer InvertibleRSAFunction::CalculateInverse(RandomNumberGenerator &rng, const Integer &x) const 
 {
 	DoQuickSanityCheck();
-	ModularArithmetic modn(m_n);
-	Integer r, rInv;
-	do {	// do this in a loop for people using small numbers for testing
-		r.Randomize(rng, Integer::One(), m_n - Integer::One());
-		rInv = modn.MultiplicativeInverse(r);
-	} while (rInv.IsZero());
-	Integer re = modn.Exponentiate(r, m_e);
-	re = modn.Multiply(re, x);			// blind
+	SlotPool<RSAArithmetic>::Borrowed arithmetic(m_arithmetic);
+	const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, arithmetic->mrn), &mrp = m_mrp.Get(m_p, arithmetic->mrp), &mrq = m_mrq.Get(m_q, arithmetic->mrq);
+	Integer blind, unblind;
+	arithmetic->blinding.Next(rng, mrn, m_e, blind, unblind);
+	Integer re = mrn.ConvertOut(mrn.Multiply(blind, mrn.ConvertIn(x)));			// blind
+	Integer yp, yq;
+	#pragma omp parallel
+		#pragma omp sections
+		{
+			#pragma omp section
+				yp = mrp.ConvertOut(mrp.Exponentiate(mrp.ConvertIn(re % m_p), m_dp));
+			#pragma omp section
+				yq = mrq.ConvertOut(mrq.Exponentiate(mrq.ConvertIn(re % m_q), m_dq));
+		}
 	// here we follow the notation of PKCS #1 and let u=q inverse mod p
-	// but in ModRoot, u=p inverse mod q, so we reverse the order of p and q
-	Integer y = ModularRoot(re, m_dq, m_dp, m_q, m_p, m_u);
-	y = modn.Multiply(y, rInv);				// unblind
-	if (modn.Exponentiate(y, m_e) != x)		// check
+	// but in CRT, u=p inverse mod q, so we reverse the order of p and q
+	Integer y = CRT(yq, m_q, yp, m_p, m_u);
+	if (!m_otherPrimes.empty())
+	{
+		// Garner's algorithm: with y correct modulo R, the product of the primes so far,
+		// add the multiple of R that makes it correct modulo the next prime r as well
+		Integer R = m_p * m_q;
+		arithmetic->mrOther.resize(m_otherPrimes.size());
+		for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+		{
+			const OtherPrimeInfo &info = m_otherPrimes[i];
+			const MontgomeryRepresentation &mr = m_mrOther[i].Get(info.prime, arithmetic->mrOther[i]);
+			Integer yr = mr.ConvertOut(mr.Exponentiate(mr.ConvertIn(re % info.prime), info.exponent));
+			// multiplying a residue in Montgomery form by a plain one gives a plain product
+			Integer h = mr.Multiply(mr.ConvertIn((yr - y % info.prime) % info.prime), info.coefficient);
+			y += R * h;
+			R *= info.prime;
+		}
+	}
+	y = mrn.ConvertOut(mrn.Multiply(mrn.ConvertIn(y), unblind));	// unblind
+	if (!IsPreimage(*arithmetic, y, x))		// check
 		throw Exception(Exception::OTHER_ERROR, "InvertibleRSAFunction: computational error during private key operation");
 	return y;
 }
 
+bool InvertibleRSAFunction::IsPreimage(RSAArithmetic &arithmetic, const Integer &y, const Integer &x) const
+{
+	switch (m_faultCheck)
+	{
+	case FULL_CHECK:
+		{
+			const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, arithmetic.mrn);
+			return mrn.ConvertOut(mrn.Exponentiate(mrn.ConvertIn(y), m_e)) == x;
+		}
+	case PUBLIC_EXPONENT_CHECK:
+		{
+			const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, arithmetic.mrn);
+			return mrn.ConvertOut(ExponentiateByPublicExponent(mrn, mrn.ConvertIn(y), m_e)) == x;
+		}
+	default:
+		{
+			// y^e = x mod each prime implies y^e = x mod n
+			bool pass = IsPreimageModPrime(m_mrp.Get(m_p, arithmetic.mrp), y, x, m_e) && IsPreimageModPrime(m_mrq.Get(m_q, arithmetic.mrq), y, x, m_e);
+			arithmetic.mrOther.resize(m_otherPrimes.size());
+			for (unsigned int i=0; i<m_otherPrimes.size() && pass; i++)
+				pass = IsPreimageModPrime(m_mrOther[i].Get(m_otherPrimes[i].prime, arithmetic.mrOther[i]), y, x, m_e);
+			return pass;
+		}
+	}
+}
+
+void InvertibleRSAFunction::PrepareArithmetic()
+{
+	m_mrn.Set(m_n);
+	m_mrp.Set(m_p);
+	m_mrq.Set(m_q);
+	m_mrOther.resize(m_otherPrimes.size());
+	for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+		m_mrOther[i].Set(m_otherPrimes[i].prime);
+}
+
 bool InvertibleRSAFunction::Validate(RandomNumberGenerator &rng, unsigned int level) const
 {
 	bool pass = RSAFunction::Validate(rng, level);
@@ -249,15 +469,35 @@ bool InvertibleRSAFunction::Validate(RandomNumberGenerator &rng, unsigned int le
 	pass = pass && m_dp > Integer::One() && m_dp.IsOdd() && m_dp < m_p;
 	pass = pass && m_dq > Integer::One() && m_dq.IsOdd() && m_dq < m_q;
 	pass = pass && m_u.IsPositive() && m_u < m_p;
+	for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+	{
+		const OtherPrimeInfo &info = m_otherPrimes[i];
+		pass = pass && info.prime > Integer::One() && info.prime.IsOdd() && info.prime < m_n;
+		pass = pass && info.exponent > Integer::One() && info.exponent.IsOdd() && info.exponent < info.prime;
+		pass = pass && info.coefficient.IsPositive() && info.coefficient < info.prime;
+	}
 	if (level >= 1)
 	{
-		pass = pass && m_p * m_q == m_n;
-		pass = pass && m_e*m_d % LCM(m_p-1, m_q-1) == 1;
+		Integer product = m_p * m_q, lambda = LCM(m_p-1, m_q-1);
+		for (unsigned int i=0; i<m_otherPrimes.size() && pass; i++)
+		{
+			const OtherPrimeInfo &info = m_otherPrimes[i];
+			pass = pass && info.exponent == m_d%(info.prime-1);
+			pass = pass && info.coefficient * product % info.prime == 1;
+			product *= info.prime;
+			lambda = LCM(lambda, info.prime-1);
+		}
+		pass = pass && product == m_n;
+		pass = pass && m_e*m_d % lambda == 1;
 		pass = pass && m_dp == m_d%(m_p-1) && m_dq == m_d%(m_q-1);
 		pass = pass && m_u * m_q % m_p == 1;
 	}
 	if (level >= 2)
+	{
 		pass = pass && VerifyPrime(rng, m_p, level-2) && VerifyPrime(rng, m_q, level-2);
+		for (unsigned int i=0; i<m_otherPrimes.size(); i++)
+			pass = pass && VerifyPrime(rng, m_otherPrimes[i].prime, level-2);
+	}
 	return pass;
 }
 
@@ -283,6 +523,8 @@ void InvertibleRSAFunction::AssignFrom(const NameValuePairs &source)
 		CRYPTOPP_SET_FUNCTION_ENTRY(ModPrime2PrivateExponent)
 		CRYPTOPP_SET_FUNCTION_ENTRY(MultiplicativeInverseOfPrime2ModPrime1)
 		;
+	m_otherPrimes.clear();	// not among the named values
+	m_mrOther.clear();
 }
 
 // *****************************************************************************
@@ -293,6 +535,14 @@ Integer RSAFunction_ISO::ApplyFunction(const Integer &x) const
 	return t % 16 == 12 ? t : m_n - t;
 }
 
+void RSAFunction_ISO::ApplyFunctions(Integer *y, const Integer *x, size_t count) const
+{
+	RSAFunction::ApplyFunctions(y, x, count);
+	for (size_t i=0; i<count; i++)
+		if (y[i] % 16 != 12)
+			y[i] = m_n - y[i];
+}
+
 Integer InvertibleRSAFunction_ISO::CalculateInverse(RandomNumberGenerator &rng, const Integer &x) const 
 {
 	Integer t = InvertibleRSAFunction::CalculateInverse(rng, x);
@@ -14,6 +14,37 @@
 
 NAMESPACE_BEGIN(CryptoPP)
 
+//! blinding factors for RSA private key operations, renewed by squaring between uses
+/*! This holds r^e and r^-1 mod n for a random r. Squaring both gives the factors for r^2,
+	which costs two modular squarings instead of an exponentiation and an inversion.
+	A new r is drawn for the first use, after every REFRESH_INTERVAL uses, and whenever
+	n or e has changed. A copy starts without factors. A key keeps one set in each slot of
+	its SlotPool of RSAArithmetic, so neither copies of a key nor threads sharing one share them. */
+class CRYPTOPP_DLL RSABlindingFactors
+{
+public:
+	enum {REFRESH_INTERVAL = 32};
+
+	RSABlindingFactors() : m_uses(0) {}
+	RSABlindingFactors(const RSABlindingFactors &) : m_uses(0) {}
+	RSABlindingFactors & operator=(const RSABlindingFactors &) {m_uses = 0; return *this;}
+
+	//! sets blind to r^e and unblind to r^-1, both in the Montgomery representation mrn
+	void Next(RandomNumberGenerator &rng, const MontgomeryRepresentation &mrn, const Integer &e, Integer &blind, Integer &unblind);
+
+private:
+	Integer m_n, m_e, m_blind, m_unblind;
+	unsigned int m_uses;
+};
+
+//! copies of the Montgomery arithmetic of an RSA key, and its blinding factors, which one thread at a time keeps between operations
+struct RSAArithmetic
+{
+	member_ptr<MontgomeryRepresentation> mrn, mrp, mrq;
+	std::vector<value_ptr<MontgomeryRepresentation> > mrOther;
+	RSABlindingFactors blinding;
+};
+
 //! _
 class CRYPTOPP_DLL RSAFunction : public TrapdoorFunction, public X509PublicKey
 {
@@ -21,7 +52,7 @@ class CRYPTOPP_DLL RSAFunction : public TrapdoorFunction, public X509PublicKey
 
 public:
 	void Initialize(const Integer &n, const Integer &e)
-		{m_n = n; m_e = e;}
+		{m_n = n; m_e = e; m_mrn.Set(m_n);}
 
 	// X509PublicKey
 	OID GetAlgorithmID() const;
@@ -35,6 +66,7 @@ public:
 
 	// TrapdoorFunction
 	Integer ApplyFunction(const Integer &x) const;
+	void ApplyFunctions(Integer *y, const Integer *x, size_t count) const;
 	Integer PreimageBound() const {return m_n;}
 	Integer ImageBound() const {return m_n;}
 
@@ -42,11 +74,16 @@ public:
 	const Integer & GetModulus() const {return m_n;}
 	const Integer & GetPublicExponent() const {return m_e;}
 
-	void SetModulus(const Integer &n) {m_n = n;}
+	void SetModulus(const Integer &n) {m_n = n; m_mrn.Set(m_n);}
 	void SetPublicExponent(const Integer &e) {m_e = e;}
 
 protected:
 	Integer m_n, m_e;
+	// built whenever n is set; the const functions use it directly only on threads with an
+	// ArithmeticWorkspace, and otherwise compute with a copy borrowed from m_arithmetic,
+	// so a key may be shared by any threads
+	CachedMontgomeryRepresentation m_mrn;
+	SlotPool<RSAArithmetic> m_arithmetic;
 };
 
 //! _
@@ -55,9 +92,31 @@ class CRYPTOPP_DLL InvertibleRSAFunction : public RSAFunction, public TrapdoorFu
 	typedef InvertibleRSAFunction ThisClass;
 
 public:
-	void Initialize(RandomNumberGenerator &rng, unsigned int modulusBits, const Integer &e = 17);
+	//! a prime factor of n beyond p and q, as OtherPrimeInfo in PKCS #1 v2.1
+	struct OtherPrimeInfo
+	{
+		Integer prime;
+		Integer exponent;		//!< d mod (prime-1)
+		Integer coefficient;	//!< inverse mod prime of the product of the primes before it
+	};
+	typedef std::vector<OtherPrimeInfo> OtherPrimeInfos;
+
+	//! how CalculateInverse() checks its result before returning it, to guard against faults that leak the primes
+	enum FaultCheck {
+		//! raise the result to e mod n with general exponentiation
+		FULL_CHECK,
+		//! raise the result to e mod n by squaring and multiplying over the bits of e, without a window table
+		PUBLIC_EXPONENT_CHECK,
+		//! raise the result to e mod each prime, which implies the check mod n at about half its cost
+		CRT_CHECK
+	};
+
+	InvertibleRSAFunction() : m_faultCheck(CRT_CHECK) {}
+
+	//! generate a key whose modulus is the product of primeCount primes of about equal size
+	void Initialize(RandomNumberGenerator &rng, unsigned int modulusBits, const Integer &e = 17, unsigned int primeCount = 2);
 	void Initialize(const Integer &n, const Integer &e, const Integer &d, const Integer &p, const Integer &q, const Integer &dp, const Integer &dq, const Integer &u)
-		{m_n = n; m_e = e; m_d = d; m_p = p; m_q = q; m_dp = dp; m_dq = dq; m_u = u;}
+		{m_n = n; m_e = e; m_d = d; m_p = p; m_q = q; m_dp = dp; m_dq = dq; m_u = u; m_otherPrimes.clear(); PrepareArithmetic();}
 	//! factor n given private exponent
 	void Initialize(const Integer &n, const Integer &e, const Integer &d);
 
@@ -79,7 +138,7 @@ public:
 
 	// GeneratableCryptoMaterial
 	bool Validate(RandomNumberGenerator &rng, unsigned int level) const;
-	/*! parameters: (ModulusSize, PublicExponent (default 17)) */
+	/*! parameters: (ModulusSize, PublicExponent (default 17), PrimeCount (default 2)) */
 	void GenerateRandom(RandomNumberGenerator &rng, const NameValuePairs &alg);
 	bool GetVoidValue(const char *name, const std::type_info &valueType, void *pValue) const;
 	void AssignFrom(const NameValuePairs &source);
@@ -91,22 +150,38 @@ public:
 	const Integer& GetModPrime1PrivateExponent() const {return m_dp;}
 	const Integer& GetModPrime2PrivateExponent() const {return m_dq;}
 	const Integer& GetMultiplicativeInverseOfPrime2ModPrime1() const {return m_u;}
+	//! the primes after p and q of a multi-prime key, which are not available as named values
+	const OtherPrimeInfos& GetOtherPrimeInfos() const {return m_otherPrimes;}
+	FaultCheck GetFaultCheck() const {return m_faultCheck;}
 
-	void SetPrime1(const Integer &p) {m_p = p;}
-	void SetPrime2(const Integer &q) {m_q = q;}
+	void SetPrime1(const Integer &p) {m_p = p; m_mrp.Set(m_p);}
+	void SetPrime2(const Integer &q) {m_q = q; m_mrq.Set(m_q);}
 	void SetPrivateExponent(const Integer &d) {m_d = d;}
 	void SetModPrime1PrivateExponent(const Integer &dp) {m_dp = dp;}
 	void SetModPrime2PrivateExponent(const Integer &dq) {m_dq = dq;}
 	void SetMultiplicativeInverseOfPrime2ModPrime1(const Integer &u) {m_u = u;}
+	void SetOtherPrimeInfos(const OtherPrimeInfos &otherPrimes) {m_otherPrimes = otherPrimes; PrepareArithmetic();}
+	void SetFaultCheck(FaultCheck faultCheck) {m_faultCheck = faultCheck;}
 
 protected:
+	void ComputePrivateValues();
+	bool IsPreimage(RSAArithmetic &arithmetic, const Integer &y, const Integer &x) const;
+	void PrepareArithmetic();
+
 	Integer m_d, m_p, m_q, m_dp, m_dq, m_u;
+	OtherPrimeInfos m_otherPrimes;
+	FaultCheck m_faultCheck;
+	// see m_mrn
+	CachedMontgomeryRepresentation m_mrp, m_mrq;
+	// one for each of m_otherPrimes, kept the same size by every function that changes them
+	std::vector<CachedMontgomeryRepresentation> m_mrOther;
 };
 
 class CRYPTOPP_DLL RSAFunction_ISO : public RSAFunction
 {
 public:
 	Integer ApplyFunction(const Integer &x) const;
+	void ApplyFunctions(Integer *y, const Integer *x, size_t count) const;
 	Integer PreimageBound() const {return ++(m_n>>1);}
 };
 
@@ -26,8 +26,19 @@ void RWFunction::DEREncode(BufferedTransformation &bt) const
 Integer RWFunction::ApplyFunction(const Integer &in) const
 {
 	DoQuickSanityCheck();
+	return CompleteFunction(in.Squared()%m_n);
+}
+
+void RWFunction::ApplyFunctions(Integer *y, const Integer *x, size_t count) const
+{
+	DoQuickSanityCheck();
+	a_exp_b_mod_c(y, x, count, Integer::Two(), m_n);
+	for (size_t i=0; i<count; i++)
+		y[i] = CompleteFunction(y[i]);
+}
 
-	Integer out = in.Squared()%m_n;
+Integer RWFunction::CompleteFunction(Integer out) const
+{
 	const word r = 12;
 	// this code was written to handle both r = 6 and r = 12,
 	// but now only r = 12 is used in P1363
@@ -99,6 +110,7 @@ void InvertibleRWFunction::GenerateRandom(RandomNumberGenerator &rng, const Name
 
 	m_n = m_p * m_q;
 	m_u = m_q.InverseMod(m_p);
+	PrepareArithmetic();
 }
 
 void InvertibleRWFunction::BERDecode(BufferedTransformation &bt)
@@ -109,6 +121,7 @@ void InvertibleRWFunction::BERDecode(BufferedTransformation &bt)
 	m_q.BERDecode(seq);
 	m_u.BERDecode(seq);
 	seq.MessageEnd();
+	PrepareArithmetic();
 }
 
 void InvertibleRWFunction::DEREncode(BufferedTransformation &bt) const
@@ -124,39 +137,64 @@ void InvertibleRWFunction::DEREncode(BufferedTransformation &bt) const
 Integer InvertibleRWFunction::CalculateInverse(RandomNumberGenerator &rng, const Integer &x) const
 {
 	DoQuickSanityCheck();
-	ModularArithmetic modn(m_n);
+	member_ptr<MontgomeryRepresentation> localN, localP, localQ;
+	const MontgomeryRepresentation &mrn = m_mrn.Get(m_n, localN), &mrp = m_mrp.Get(m_p, localP), &mrq = m_mrq.Get(m_q, localQ);
 	Integer r, rInv;
 	do {	// do this in a loop for people using small numbers for testing
 		r.Randomize(rng, Integer::One(), m_n - Integer::One());
-		rInv = modn.MultiplicativeInverse(r);
+		rInv = r.InverseMod(m_n);
 	} while (rInv.IsZero());
-	Integer re = modn.Square(r);
-	re = modn.Multiply(re, x);			// blind
-
-	Integer cp=re%m_p, cq=re%m_q;
-	if (Jacobi(cp, m_p) * Jacobi(cq, m_q) != 1)
-	{
-		cp = cp.IsOdd() ? (cp+m_p) >> 1 : cp >> 1;
-		cq = cq.IsOdd() ? (cq+m_q) >> 1 : cq >> 1;
-	}
+	r = mrn.ConvertIn(r);
+	Integer re = mrn.Square(r);
+	re = mrn.Multiply(re, x%m_n);		// blind; a product of Montgomery and ordinary forms is ordinary
 
+	Integer cp, cq;
+	int jp, jq;
 	#pragma omp parallel
 		#pragma omp sections
 		{
 			#pragma omp section
-				cp = ModularSquareRoot(cp, m_p);
+				cp = ModularSquareRoot(mrp, re%m_p, jp);
 			#pragma omp section
-				cq = ModularSquareRoot(cq, m_q);
+				cq = ModularSquareRoot(mrq, re%m_q, jq);
 		}
 
+	// the roots of re/2 are those of re times the cached roots of 1/2
+	if (jp * jq != 1)
+	{
+		cp = mrp.Multiply(cp, m_rootHalfP);
+		cq = mrq.Multiply(cq, m_rootHalfQ);
+	}
+
 	Integer y = CRT(cq, m_q, cp, m_p, m_u);
-	y = modn.Multiply(y, rInv);				// unblind
+	rInv = mrn.ConvertIn(rInv);
+	y = mrn.Multiply(rInv, y);				// unblind
 	y = STDMIN(y, m_n-y);
 	if (ApplyFunction(y) != x)				// check
 		throw Exception(Exception::OTHER_ERROR, "InvertibleRWFunction: computational error during private key operation");
 	return y;
 }
 
+void InvertibleRWFunction::PrepareArithmetic()
+{
+	m_mrn.Set(m_n);
+	PreparePrime(m_mrp, m_p, m_rootHalfP);
+	PreparePrime(m_mrq, m_q, m_rootHalfQ);
+}
+
+void InvertibleRWFunction::PreparePrime(CachedMontgomeryRepresentation &mr, const Integer &p, Integer &rootHalf)
+{
+	mr.Set(p);
+	if (p <= Integer::One() || p%4 != 3)
+	{
+		rootHalf = Integer::Zero();	// not a valid key, which Validate() reports
+		return;
+	}
+
+	member_ptr<MontgomeryRepresentation> local;
+	rootHalf = mr.Get(p, local).ConvertIn(a_exp_b_mod_c((p+1) >> 1, (p+1) >> 2, p));
+}
+
 bool InvertibleRWFunction::Validate(RandomNumberGenerator &rng, unsigned int level) const
 {
 	bool pass = RWFunction::Validate(rng, level);
@@ -189,6 +227,7 @@ void InvertibleRWFunction::AssignFrom(const NameValuePairs &source)
 		CRYPTOPP_SET_FUNCTION_ENTRY(Prime2)
 		CRYPTOPP_SET_FUNCTION_ENTRY(MultiplicativeInverseOfPrime2ModPrime1)
 		;
+	m_mrn.Set(m_n);
 }
 
 NAMESPACE_END
@@ -28,6 +28,7 @@ public:
 		{BERDecode(bt);}
 
 	Integer ApplyFunction(const Integer &x) const;
+	void ApplyFunctions(Integer *y, const Integer *x, size_t count) const;
 	Integer PreimageBound() const {return ++(m_n>>1);}
 	Integer ImageBound() const {return m_n;}
 
@@ -39,6 +40,9 @@ public:
 	void SetModulus(const Integer &n) {m_n = n;}
 
 protected:
+	// maps the square of the input mod n to the function value
+	Integer CompleteFunction(Integer out) const;
+
 	Integer m_n;
 };
 
@@ -49,7 +53,7 @@ class CRYPTOPP_DLL InvertibleRWFunction : public RWFunction, public TrapdoorFunc
 
 public:
 	void Initialize(const Integer &n, const Integer &p, const Integer &q, const Integer &u)
-		{m_n = n; m_p = p; m_q = q; m_u = u;}
+		{m_n = n; m_p = p; m_q = q; m_u = u; PrepareArithmetic();}
 	// generate a random private key
 	void Initialize(RandomNumberGenerator &rng, unsigned int modulusBits)
 		{GenerateRandomWithKeySize(rng, modulusBits);}
@@ -75,12 +79,22 @@ public:
 	const Integer& GetPrime2() const {return m_q;}
 	const Integer& GetMultiplicativeInverseOfPrime2ModPrime1() const {return m_u;}
 
-	void SetPrime1(const Integer &p) {m_p = p;}
-	void SetPrime2(const Integer &q) {m_q = q;}
+	// SetModulus() hides that of RWFunction so that the arithmetic mod n stays current
+	void SetModulus(const Integer &n) {m_n = n; m_mrn.Set(m_n);}
+	void SetPrime1(const Integer &p) {m_p = p; PreparePrime(m_mrp, m_p, m_rootHalfP);}
+	void SetPrime2(const Integer &q) {m_q = q; PreparePrime(m_mrq, m_q, m_rootHalfQ);}
 	void SetMultiplicativeInverseOfPrime2ModPrime1(const Integer &u) {m_u = u;}
 
 protected:
+	void PrepareArithmetic();
+	static void PreparePrime(CachedMontgomeryRepresentation &mr, const Integer &p, Integer &rootHalf);
+
 	Integer m_p, m_q, m_u;
+	// Montgomery arithmetic mod n, p and q, kept like that of RSA keys (see RSAFunction::m_mrn)
+	CachedMontgomeryRepresentation m_mrn, m_mrp, m_mrq;
+	// (1/2)^((p+1)/4) mod p and (1/2)^((q+1)/4) mod q in Montgomery form;
+	// every function that changes p or q computes them again, so CalculateInverse() only reads them
+	Integer m_rootHalfP, m_rootHalfQ;
 };
 
 //! RW
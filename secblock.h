@@ -7,6 +7,10 @@
 #include "misc.h"
 #include <assert.h>
 
+#ifdef CRYPTOPP_SCRATCH_ARENA
+#include <vector>
+#endif
+
 NAMESPACE_BEGIN(CryptoPP)
 
 // ************** secure memory allocation ***************
@@ -33,6 +37,9 @@ public:
 	void destroy(pointer p) {p->~T();}
 	size_type max_size() const {return ~size_type(0)/sizeof(T);}	// switch to std::numeric_limits<T>::max later
 
+	//! returns whether p points to storage inside the allocator object itself
+	bool IsInternal(const void *p) const {return false;}
+
 protected:
 	static void CheckSize(size_t n)
 	{
@@ -80,6 +87,72 @@ typename A::pointer StandardReallocate(A& a, T *p, typename A::size_type oldSize
 #pragma warning(pop)
 #endif
 
+#ifdef CRYPTOPP_SCRATCH_ARENA
+//! per-thread cache of secure memory blocks, available when CRYPTOPP_SCRATCH_ARENA is defined (see config.h)
+/*! While a ScratchArena exists on a thread and a ScratchArena::Scope is open on it,
+	blocks that AllocatorWithCleanup releases on that thread are wiped as usual and then
+	kept by the arena instead of being freed, and later requests for blocks of the same size
+	are served from them. This removes most of the heap traffic caused by short-lived Integer and
+	SecByteBlock temporaries. PK_Signer and PK_Verifier open a Scope around each operation,
+	so an application only has to create an arena on each thread that signs or verifies.
+	Arenas nest, and only the outermost one on a thread takes effect. The blocks are ordinary heap
+	blocks, so objects may outlive the Scope or the arena they were allocated under, and may be
+	released on another thread. */
+class CRYPTOPP_DLL ScratchArena
+{
+public:
+	//! at most maxBlocks released blocks are kept
+	ScratchArena(unsigned int maxBlocks = 32);
+	~ScratchArena();
+
+	//! routes the calling thread's secure allocations through its arena while it exists
+	/*! When the outermost Scope on a thread is destroyed, the blocks kept by the arena are
+		freed, so no memory touched by the operation stays in the arena between operations. */
+	class CRYPTOPP_DLL Scope
+	{
+	public:
+		Scope();
+		~Scope();
+
+	private:
+		Scope(const Scope &);
+		void operator=(const Scope &);
+
+		ScratchArena *m_arena;
+	};
+
+	//! returns the number of released blocks currently kept
+	unsigned int BlocksKept() const {return (unsigned int)m_blocks.size();}
+	//! returns the number of requests that were served from kept blocks
+	lword BlocksReused() const {return m_reused;}
+
+	//! allocates size bytes, aligned on 16 if aligned is true
+	static void * Allocate(size_t size, bool aligned);
+	//! releases a block returned by Allocate(size, aligned), which the caller has already wiped
+	static void Deallocate(void *p, size_t size, bool aligned);
+
+private:
+	ScratchArena(const ScratchArena &);
+	void operator=(const ScratchArena &);
+
+	struct Block
+	{
+		void *p;
+		size_t size;
+		bool aligned;
+	};
+
+	static ScratchArena * Current();
+	static void Free(const Block &block);
+	void Reset();
+
+	std::vector<Block> m_blocks;
+	unsigned int m_maxBlocks, m_scopes;
+	lword m_reused;
+	bool m_installed;
+};
+#endif
+
 template <class T, bool T_Align16 = false>
 class AllocatorWithCleanup : public AllocatorBase<T>
 {
@@ -92,24 +165,32 @@ public:
 		if (n == 0)
 			return NULL;
 
+#ifdef CRYPTOPP_SCRATCH_ARENA
+		return (pointer)ScratchArena::Allocate(n*sizeof(T), IsAligned(n));
+#else
 #if CRYPTOPP_BOOL_ALIGN16_ENABLED
-		if (T_Align16 && n*sizeof(T) >= 16)
+		if (IsAligned(n))
 			return (pointer)AlignedAllocate(n*sizeof(T));
 #endif
 
 		return (pointer)UnalignedAllocate(n*sizeof(T));
+#endif
 	}
 
 	void deallocate(void *p, size_type n)
 	{
 		SecureWipeArray((pointer)p, n);
 
+#ifdef CRYPTOPP_SCRATCH_ARENA
+		ScratchArena::Deallocate(p, n*sizeof(T), IsAligned(n));
+#else
 #if CRYPTOPP_BOOL_ALIGN16_ENABLED
-		if (T_Align16 && n*sizeof(T) >= 16)
+		if (IsAligned(n))
 			return AlignedDeallocate(p);
 #endif
 
 		UnalignedDeallocate(p);
+#endif
 	}
 
 	pointer reallocate(T *p, size_type oldSize, size_type newSize, bool preserve)
@@ -124,6 +205,16 @@ public:
 	AllocatorWithCleanup() {}
 	template <class U, bool A> AllocatorWithCleanup(const AllocatorWithCleanup<U, A> &) {}
 #endif
+
+private:
+	static bool IsAligned(size_type n)
+	{
+#if CRYPTOPP_BOOL_ALIGN16_ENABLED
+		return T_Align16 && n*sizeof(T) >= 16;
+#else
+		return false;
+#endif
+	}
 };
 
 CRYPTOPP_DLL_TEMPLATE_CLASS AllocatorWithCleanup<byte>;
@@ -221,12 +312,14 @@ public:
 
 	size_type max_size() const {return STDMAX(m_fallbackAllocator.max_size(), S);}
 
+	bool IsInternal(const void *p) const {return p == GetAlignedArray();}
+
 private:
 #ifdef __BORLANDC__
-	T* GetAlignedArray() {return m_array;}
+	T* GetAlignedArray() const {return (T*)m_array;}
 	T m_array[S];
 #else
-	T* GetAlignedArray() {return (CRYPTOPP_BOOL_ALIGN16_ENABLED && T_Align16) ? (T*)(((byte *)m_array) + (0-(size_t)m_array)%16) : m_array;}
+	T* GetAlignedArray() const {return (CRYPTOPP_BOOL_ALIGN16_ENABLED && T_Align16) ? (T*)(((byte *)m_array) + (0-(size_t)m_array)%16) : (T*)m_array;}
 	CRYPTOPP_ALIGN_DATA(8) T m_array[(CRYPTOPP_BOOL_ALIGN16_ENABLED && T_Align16) ? S+8/sizeof(T) : S];
 #endif
 	A m_fallbackAllocator;
@@ -402,6 +495,15 @@ public:
 	//! swap contents and size with another SecBlock
 	void swap(SecBlock<T, A> &b)
 	{
+		if (m_alloc.IsInternal(m_ptr) || b.m_alloc.IsInternal(b.m_ptr))
+		{
+			// storage inside an allocator can't change hands, so exchange the contents instead
+			SecBlock<T, A> t(*this);
+			Assign(b);
+			b.Assign(t);
+			return;
+		}
+
 		std::swap(m_alloc, b.m_alloc);
 		std::swap(m_size, b.m_size);
 		std::swap(m_ptr, b.m_ptr);
@@ -311,6 +311,8 @@ int CRYPTOPP_API main(int argc, char *argv[])
 			BenchmarkAll(argc<3 ? 1 : atof(argv[2]), argc<4 ? 0 : atof(argv[3])*1e9);
 		else if (command == "b2")
 			BenchmarkAll2(argc<3 ? 1 : atof(argv[2]), argc<4 ? 0 : atof(argv[3])*1e9);
+		else if (command == "tune")
+			TuneIntegerMultiplication(argc<3 ? 0.25 : atof(argv[2]), argc<4 ? "integer-tuning.txt" : argv[3]);
 		else if (command == "z")
 			GzipFile(argv[3], argv[4], argv[2][0]-'0');
 		else if (command == "u")
@@ -28,6 +28,11 @@
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
+
+#ifdef HAS_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "validate.h"
 
@@ -151,6 +156,76 @@ bool SignatureValidate(PK_Signer &priv, PK_Verifier &pub, bool thorough = false)
 	return pass;
 }
 
+template <class VERIFIER>
+bool BatchSignatureValidate(PK_Signer &priv, const VERIFIER &pub)
+{
+	const unsigned int count = 8;
+	const byte *message = (byte *)"test message";
+	const int messageLen = 12;
+
+	std::vector<SecByteBlock> signatures(count);
+	typename VERIFIER::Item items[count];
+	bool results[count];
+
+	for (unsigned int i=0; i<count; i++)
+	{
+		signatures[i].New(priv.MaxSignatureLength());
+		items[i].message = message;
+		items[i].messageLength = messageLen - i%2;
+		items[i].signatureLength = priv.SignMessage(GlobalRNG(), items[i].message, items[i].messageLength, signatures[i]);
+		items[i].signature = signatures[i];
+	}
+
+	bool fail = !pub.VerifyMessages(items, count, results);
+	for (unsigned int i=0; i<count; i++)
+		fail = fail || !results[i];
+	bool pass = !fail;
+
+	cout << (fail ? "FAILED    " : "passed    ");
+	cout << "batch signature verification\n";
+
+	++signatures[3][0];
+	items[5].messageLength = 0;
+	items[6].signatureLength--;
+	fail = pub.VerifyMessages(items, count, results);
+	for (unsigned int i=0; i<count; i++)
+		fail = fail || results[i] != (i != 3 && i != 5 && i != 6);
+	pass = pass && !fail;
+
+	cout << (fail ? "FAILED    " : "passed    ");
+	cout << "batch verification with invalid signatures" << endl;
+
+	return pass;
+}
+
+template <class SIGNER>
+bool BatchSigningValidate(const SIGNER &priv, const PK_Verifier &pub)
+{
+	const unsigned int count = 8;
+	const byte *message = (byte *)"test message";
+	const int messageLen = 12;
+
+	typename SIGNER::Item items[count];
+	for (unsigned int i=0; i<count; i++)
+	{
+		items[i].message = message;
+		items[i].messageLength = messageLen - i%3;
+	}
+
+	const size_t signatureLength = priv.SignatureLength();
+	SecByteBlock signatures(count * signatureLength);
+	priv.SignMessages(GlobalRNG(), items, count, signatures);
+
+	bool fail = false;
+	for (unsigned int i=0; i<count; i++)
+		fail = fail || !pub.VerifyMessage(items[i].message, items[i].messageLength, signatures+i*signatureLength, signatureLength);
+
+	cout << (fail ? "FAILED    " : "passed    ");
+	cout << "batch signing" << endl;
+
+	return !fail;
+}
+
 bool CryptoSystemValidate(PK_Decryptor &priv, PK_Encryptor &pub, bool thorough = false)
 {
 	bool pass = true, fail;
@@ -253,6 +328,82 @@ bool AuthenticatedKeyAgreementValidate(AuthenticatedKeyAgreementDomain &d)
 	return true;
 }
 
+#ifdef HAS_PTHREADS
+struct ReplacedMontgomeryTest
+{
+	MontgomeryRepresentation *mr;
+	Integer modulus;
+};
+
+static void * ReplaceMontgomeryRepresentation(void *param)
+{
+	ReplacedMontgomeryTest &test = *(ReplacedMontgomeryTest *)param;
+	test.mr->~MontgomeryRepresentation();
+	new (test.mr) MontgomeryRepresentation(test.modulus);
+	return NULL;
+}
+
+struct SharedRSAKeyTest
+{
+	const InvertibleRSAFunction *key;
+	unsigned int failures;
+};
+
+// private key operations on a key that other threads use at the same time, without an ArithmeticWorkspace
+static void * RunSharedRSAKeyTest(void *param)
+{
+	SharedRSAKeyTest &test = *(SharedRSAKeyTest *)param;
+	AutoSeededRandomPool rng;
+	for (unsigned int i=0; i<2000; i++)
+	{
+		Integer x(rng, Integer::Zero(), test.key->GetModulus()-1);
+		try
+		{
+			if (test.key->ApplyFunction(test.key->CalculateInverse(rng, x)) != x)
+				test.failures++;
+		}
+		catch (const Exception &)
+		{
+			test.failures++;
+		}
+	}
+	return NULL;
+}
+
+struct RekeyedRSATest
+{
+	const RSAFunction *key;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	unsigned int keysSet, keysUsed, failures;
+};
+
+// public key operations on a thread with a long-lived ArithmeticWorkspace, on a key that
+// another thread initializes again with a modulus of another length between them
+static void * RunRekeyedRSATest(void *param)
+{
+	RekeyedRSATest &test = *(RekeyedRSATest *)param;
+	ArithmeticWorkspace workspace;
+	for (unsigned int i=0; i<12; i++)
+	{
+		pthread_mutex_lock(&test.mutex);
+		while (test.keysSet <= i)
+			pthread_cond_wait(&test.cond, &test.mutex);
+		pthread_mutex_unlock(&test.mutex);
+
+		const Integer &n = test.key->GetModulus(), &e = test.key->GetPublicExponent(), x = n/3;
+		if (test.key->ApplyFunction(x) != a_exp_b_mod_c(x, e, n))
+			test.failures++;
+
+		pthread_mutex_lock(&test.mutex);
+		test.keysUsed = i+1;
+		pthread_cond_signal(&test.cond);
+		pthread_mutex_unlock(&test.mutex);
+	}
+	return NULL;
+}
+#endif
+
 bool ValidateRSA()
 {
 	cout << "\nRSA validation suite running...\n\n";
@@ -305,6 +456,141 @@ bool ValidateRSA()
 
 		pass = CryptoSystemValidate(rsaPriv, rsaPub) && pass;
 	}
+	{
+		// enough private key operations to renew the blinding factors by squaring and redraw them,
+		// on a key and on a copy that must not share its factors
+		FileSource keys("TestData/rsa1024.dat", true, new HexDecoder);
+		InvertibleRSAFunction priv;
+		priv.BERDecode(keys);
+		InvertibleRSAFunction copy(priv);
+		fail = false;
+		for (unsigned int i=0; i<2*RSABlindingFactors::REFRESH_INTERVAL+1; i++)
+		{
+			Integer x(GlobalRNG(), Integer::Zero(), priv.GetModulus()-1);
+			const InvertibleRSAFunction &key = i%3 ? priv : copy;
+			fail = fail || key.ApplyFunction(key.CalculateInverse(GlobalRNG(), x)) != x;
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "private key operations with renewed blinding factors\n";
+	}
+#ifdef HAS_PTHREADS
+	{
+		FileSource keys("TestData/rsa1024.dat", true, new HexDecoder);
+		InvertibleRSAFunction priv;
+		priv.BERDecode(keys);
+		SharedRSAKeyTest tests[2];
+		pthread_t threads[2];
+		unsigned int started = 0;
+		for (unsigned int i=0; i<2; i++)
+		{
+			tests[i].key = &priv;
+			tests[i].failures = 0;
+			if (pthread_create(&threads[i], NULL, &RunSharedRSAKeyTest, &tests[i]) == 0)
+				started++;
+		}
+		for (unsigned int i=0; i<started; i++)
+			pthread_join(threads[i], NULL);
+		fail = started != 2 || tests[0].failures != 0 || tests[1].failures != 0;
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "private key operations by two threads sharing a key\n";
+	}
+	{
+		const unsigned int bits[3] = {512, 1024, 4096};
+		RSAFunction pub;
+		RekeyedRSATest test;
+		test.key = &pub;
+		test.keysSet = test.keysUsed = test.failures = 0;
+		pthread_mutex_init(&test.mutex, NULL);
+		pthread_cond_init(&test.cond, NULL);
+		pthread_t thread;
+		bool started = pthread_create(&thread, NULL, &RunRekeyedRSATest, &test) == 0;
+		fail = !started;
+		for (unsigned int i=0; i<12; i++)
+		{
+			// the key builds the arithmetic of each modulus in place of the last one, so the other thread
+			// must not reuse the shorter workspace copies of an earlier modulus
+			const unsigned int length = bits[i%3];
+			Integer n(GlobalRNG(), Integer::Power2(length-1), Integer::Power2(length)-1), x(GlobalRNG(), Integer::Zero(), n-1);
+			n.SetBit(0);
+			pub.Initialize(n, 65537);
+			if (started)
+			{
+				pthread_mutex_lock(&test.mutex);
+				test.keysSet = i+1;
+				pthread_cond_signal(&test.cond);
+				while (test.keysUsed <= i)
+					pthread_cond_wait(&test.cond, &test.mutex);
+				pthread_mutex_unlock(&test.mutex);
+			}
+			// and on this thread, which has no workspace, after the other one
+			fail = fail || pub.ApplyFunction(x) != a_exp_b_mod_c(x, 65537, n);
+		}
+		if (started)
+			pthread_join(thread, NULL);
+		pthread_cond_destroy(&test.cond);
+		pthread_mutex_destroy(&test.mutex);
+		fail = fail || test.failures != 0;
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "public key operations on a key initialized again by another thread\n";
+	}
+#endif
+	{
+		fail = false;
+		for (unsigned int primeCount=3; primeCount<=5; primeCount++)
+		{
+			InvertibleRSAFunction priv;
+			priv.Initialize(GlobalRNG(), 1024, 17, primeCount);
+			fail = fail || priv.GetModulus().BitCount() != 1024 || priv.GetOtherPrimeInfos().size() != primeCount-2;
+			fail = fail || !priv.Validate(GlobalRNG(), 3);
+
+			ByteQueue queue;
+			priv.DEREncode(queue);
+			InvertibleRSAFunction decoded;
+			decoded.BERDecode(queue);
+			fail = fail || decoded.GetOtherPrimeInfos().size() != primeCount-2 || !decoded.Validate(GlobalRNG(), 1);
+
+			Integer x(GlobalRNG(), Integer::Zero(), priv.GetModulus()-1);
+			fail = fail || decoded.ApplyFunction(decoded.CalculateInverse(GlobalRNG(), x)) != x;
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "multi-prime key generation, encoding and private key operations\n";
+	}
+	{
+		// each fault check passes correct results and catches a wrong private exponent mod p
+		FileSource keys("TestData/rsa1024.dat", true, new HexDecoder);
+		InvertibleRSAFunction priv;
+		priv.BERDecode(keys);
+		InvertibleRSAFunction faulty(priv);
+		faulty.SetModPrime1PrivateExponent(priv.GetModPrime1PrivateExponent()+2);
+		const InvertibleRSAFunction::FaultCheck faultChecks[] = {InvertibleRSAFunction::FULL_CHECK,
+			InvertibleRSAFunction::PUBLIC_EXPONENT_CHECK, InvertibleRSAFunction::CRT_CHECK};
+		fail = priv.GetFaultCheck() != InvertibleRSAFunction::CRT_CHECK;
+		for (unsigned int i=0; i<sizeof(faultChecks)/sizeof(faultChecks[0]); i++)
+		{
+			priv.SetFaultCheck(faultChecks[i]);
+			faulty.SetFaultCheck(faultChecks[i]);
+			Integer x(GlobalRNG(), Integer::Zero(), priv.GetModulus()-1);
+			fail = fail || priv.ApplyFunction(priv.CalculateInverse(GlobalRNG(), x)) != x;
+			try
+			{
+				faulty.CalculateInverse(GlobalRNG(), x);
+				fail = true;
+			}
+			catch (Exception &) {}
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "fault checks of private key operations\n";
+	}
 	{
 		byte *plain = (byte *)
 			"\x54\x85\x9b\x34\x2c\x49\xea\x2a";
@@ -336,6 +622,151 @@ bool ValidateRSA()
 		cout << (fail ? "FAILED    " : "passed    ");
 		cout << "PKCS 2.0 encryption and decryption\n";
 	}
+	{
+		const size_t karatsubaThreshold = Integer::KaratsubaThreshold(), toom3Threshold = Integer::Toom3Threshold();
+		fail = false;
+		for (size_t words = 8; words <= 256; words *= 2)
+		{
+			Integer a(GlobalRNG(), words*WORD_BITS), b(GlobalRNG(), words*WORD_BITS-17), m = Integer::Power2(words*WORD_BITS)-1;
+			Integer::SetKaratsubaThreshold(0);
+			Integer::SetToom3Threshold(0);
+			Integer ab = a*b, aa = a.Squared(), mm = m.Squared();
+			Integer::SetToom3Threshold(8);
+			fail = ab != a*b || aa != a.Squared() || mm != m.Squared() || fail;
+			Integer::SetToom3Threshold(0);
+			Integer::SetKaratsubaThreshold(1024);
+			fail = ab != a*b || aa != a.Squared() || mm != m.Squared() || fail;
+		}
+
+		std::stringstream tuning;
+		Integer::SetKaratsubaThreshold(64);
+		Integer::SetToom3Threshold(96);
+		Integer::SaveTuning(tuning);
+		Integer::SetKaratsubaThreshold(0);
+		Integer::SetToom3Threshold(0);
+		Integer::LoadTuning(tuning);
+		fail = fail || Integer::KaratsubaThreshold() != 64 || Integer::Toom3Threshold() != 96;
+		try
+		{
+			std::istringstream invalid("karatsuba-threshold 32\ntoom3-threshold many\n");
+			Integer::LoadTuning(invalid);
+			fail = true;
+		}
+		catch (InvalidArgument &)
+		{
+			fail = fail || Integer::KaratsubaThreshold() != 64;
+		}
+
+		Integer::SetKaratsubaThreshold(karatsubaThreshold);
+		Integer::SetToom3Threshold(toom3Threshold);
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "schoolbook, Karatsuba and Toom-3 multiplication and squaring, and tuning files\n";
+	}
+	{
+		FileSource keys("TestData/rsa2048.dat", true, new HexDecoder);
+		RSASS<PKCS1v15, SHA>::Signer rsaPriv(keys);
+		RSASS<PKCS1v15, SHA>::Verifier rsaPub(rsaPriv);
+
+		pass = BatchSignatureValidate(rsaPriv, rsaPub) && pass;
+	}
+	{
+		const unsigned int count = 11;
+		Integer x[count], y[count];
+		fail = false;
+		for (unsigned int bits = 511; bits <= 4096; bits = bits*2+1)
+		{
+			Integer m(GlobalRNG(), Integer::Power2(bits-1), Integer::Power2(bits)-1), e(GlobalRNG(), 64);
+			m.SetBit(0);
+			for (unsigned int i=0; i<count; i++)
+				x[i] = Integer(GlobalRNG(), Integer::Zero(), m-1);
+			x[1] = Integer::Zero();
+			x[2] = m-1;
+			x[3] = m+5;
+			x[4] = -x[4];
+			a_exp_b_mod_c(y, x, count, e, m);
+			for (unsigned int i=0; i<count; i++)
+				fail = fail || y[i] != a_exp_b_mod_c(x[i], e, m);
+			a_exp_b_mod_c(y, x, count, Integer::Two(), m+1);
+			for (unsigned int i=0; i<count; i++)
+				fail = fail || y[i] != a_exp_b_mod_c(x[i], Integer::Two(), m+1);
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "modular exponentiation of many bases\n";
+	}
+	{
+		fail = false;
+		for (unsigned int bits = 2; bits <= 9000; bits = bits*3/2+1)
+		{
+			Integer m(GlobalRNG(), Integer::Power2(bits-1), Integer::Power2(bits)-1), g(GlobalRNG(), Integer::One(), Integer::Power2(bits/3+1));
+			Integer a(GlobalRNG(), Integer::Zero(), m-1), b = a*g, d = Integer::Gcd(b, m*g);
+			Integer u = a.InverseMod(m), v = b.InverseMod(m+1);
+			fail = fail || d != Integer::Gcd(a, m)*g || !Integer::Gcd(b/d, m*g/d).IsUnit();
+			fail = fail || (Integer::Gcd(a, m).IsUnit() ? a*u%m != Integer::One() : !!u);
+			fail = fail || (Integer::Gcd(b, m+1).IsUnit() ? b*v%(m+1) != Integer::One() : !!v);
+			if (m.IsOdd())
+			{
+				MontgomeryRepresentation mr(m);
+				fail = fail || mr.ConvertOut(mr.MultiplicativeInverse(mr.ConvertIn(a))) != u;
+			}
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "modular inverse and GCD\n";
+	}
+	{
+		const unsigned int count = 13;
+		Integer x[count], y[count];
+		fail = false;
+		for (unsigned int bits = 160; bits <= 2048; bits *= 2)
+		{
+			Integer m(GlobalRNG(), Integer::Power2(bits-1), Integer::Power2(bits)-1);
+			for (unsigned int parity = 0; parity < 2; parity++, ++m)
+			{
+				ModularArithmetic ma(m);
+				for (unsigned int i=0; i<count; i++)
+					x[i] = y[i] = Integer(GlobalRNG(), Integer::Zero(), m-1);
+				x[2] = y[2] = Integer::Zero();
+				x[5] = y[5] = Integer::Gcd(m, x[4]) * 3;
+				ma.SimultaneousInverse(y, count);
+				for (unsigned int i=0; i<count; i++)
+					fail = fail || y[i] != x[i].InverseMod(m);
+			}
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "simultaneous modular inverse\n";
+	}
+	{
+		fail = false;
+		for (unsigned int bits = 2; bits <= 1024; bits += bits/4+1)
+		{
+			Integer m(GlobalRNG(), Integer::Power2(bits-1), Integer::Power2(bits)-1);
+			// assigned as DL_GroupParameters does when it caches one
+			BarrettReducer reducer;
+			reducer = BarrettReducer(m);
+			for (unsigned int i=0; i<16; i++)
+			{
+				Integer a(GlobalRNG(), GlobalRNG().GenerateWord32(0, 3*bits));
+				if (i%4 == 1)
+					a = m*m - i;
+				else if (i%4 == 2)
+					a.Negate();
+				fail = fail || reducer.Reduce(a) != a%m;
+			}
+			Integer x(GlobalRNG(), Integer::Zero(), m-1), y(GlobalRNG(), Integer::Zero(), m-1);
+			fail = fail || reducer.Multiply(x, y) != x*y%m;
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "Barrett reduction\n";
+	}
 
 	return pass;
 }
@@ -428,6 +859,8 @@ bool ValidateNR()
 		NR<SHA>::Verifier pubS(privS);
 
 		pass = SignatureValidate(privS, pubS) && pass;
+		pass = BatchSignatureValidate(privS, pubS) && pass;
+		pass = BatchSigningValidate(privS, pubS) && pass;
 	}
 	{
 		cout << "Generating new signature key..." << endl;
@@ -451,6 +884,71 @@ bool ValidateDSA(bool thorough)
 	DSA::Verifier pub1(fs2);
 	assert(pub.GetKey() == pub1.GetKey());
 	pass = SignatureValidate(priv, pub, thorough) && pass;
+	pass = BatchSignatureValidate(priv, pub) && pass;
+	pass = BatchSigningValidate(priv, pub) && pass;
+	{
+		cout << "Using a per-thread arithmetic workspace..." << endl;
+		ArithmeticWorkspace workspace;
+		pass = SignatureValidate(priv, pub) && pass;
+#ifdef HAS_PTHREADS
+		// another thread replaces a Montgomery representation that this thread has used through its workspace
+		// by one for a larger modulus at the same address, whose scratch space this thread must not take from the old one
+		Integer small(GlobalRNG(), 256), large(GlobalRNG(), 4096);
+		small.SetBit(0);
+		large.SetBit(0);
+		large.SetBit(4095);
+		void *buffer = ::operator new(sizeof(MontgomeryRepresentation));
+		MontgomeryRepresentation *mr = new (buffer) MontgomeryRepresentation(small);
+		Integer a(GlobalRNG(), Integer::Zero(), small-1), b(GlobalRNG(), Integer::Zero(), large-1);
+		bool fail = mr->ConvertOut(mr->Multiply(mr->ConvertIn(a), mr->ConvertIn(a))) != a.Squared()%small;
+		ReplacedMontgomeryTest test = {mr, large};
+		pthread_t thread;
+		fail = fail || pthread_create(&thread, NULL, &ReplaceMontgomeryRepresentation, &test) != 0 || pthread_join(thread, NULL) != 0;
+		fail = fail || mr->ConvertOut(mr->Multiply(mr->ConvertIn(b), mr->ConvertIn(b))) != b.Squared()%large;
+		mr->~MontgomeryRepresentation();
+		::operator delete(buffer);
+		pass = pass && !fail;
+		cout << (fail ? "FAILED    " : "passed    ") << "arithmetic replaced by another thread at the same address" << endl;
+#endif
+	}
+#ifdef CRYPTOPP_SCRATCH_ARENA
+	{
+		cout << "Using a per-thread scratch arena..." << endl;
+		ScratchArena arena;
+		pass = SignatureValidate(priv, pub) && pass;
+		bool fail = arena.BlocksReused() == 0 || arena.BlocksKept() != 0;
+		{
+			ScratchArena::Scope scope;
+			for (unsigned int i=0; i<40; i++)
+				SecByteBlock empty(0);
+			fail = fail || arena.BlocksKept() != 0;
+		}
+		pass = pass && !fail;
+		cout << (fail ? "FAILED    " : "passed    ") << "temporaries reused during each operation and released after it" << endl;
+	}
+#endif
+	{
+		cout << "Using adaptive public element precomputation..." << endl;
+		DSA::Verifier pub2(priv), pub3(priv), pub4(priv);
+		pub4.AccessKey().AccessAbstractGroupParameters().Precompute(16);
+		size_t tableBytes = 16 * pub2.GetKey().GetAbstractGroupParameters().GetEncodedElementSize(false);
+		DL_AdaptivePrecomputation::SetPolicy(1, 3 * tableBytes, 16);
+		pass = SignatureValidate(priv, pub2) && pass;
+		bool fail = DL_AdaptivePrecomputation::MemoryInUse() != 2 * tableBytes;
+		// the budget has no room for the two tables of pub3, but has for the one of pub4, whose group has its own
+		pass = SignatureValidate(priv, pub3) && pass;
+		pass = SignatureValidate(priv, pub4) && pass;
+		fail = fail || DL_AdaptivePrecomputation::MemoryInUse() != 3 * tableBytes;
+		{
+			DSA::Verifier pub5(pub2);
+			fail = fail || DL_AdaptivePrecomputation::MemoryInUse() != 5 * tableBytes;
+		}
+		fail = fail || DL_AdaptivePrecomputation::MemoryInUse() != 3 * tableBytes;
+		DL_AdaptivePrecomputation::SetPolicy(0, 0);
+		pass = pass && !fail;
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "public element precomputation within the memory budget" << endl;
+	}
 	pass = RunTestDataFile("TestVectors/dsa.txt", g_nullNameValuePairs, thorough) && pass;
 	return pass;
 }
@@ -503,6 +1001,31 @@ bool ValidateRabin()
 		RabinSS<PSSR, SHA>::Signer priv(f);
 		RabinSS<PSSR, SHA>::Verifier pub(priv);
 		pass = SignatureValidate(priv, pub) && pass;
+		pass = BatchSignatureValidate(priv, pub) && pass;
+	}
+	{
+		// on a decoded key, whose signing constants are computed when it is loaded, on a key
+		// assigned from named values, and on a key whose r is changed through RabinFunction,
+		// which leaves the constants computed from the old r
+		FileSource f("TestData/rabi1024.dat", true, new HexDecoder);
+		InvertibleRabinFunction priv, assigned, changed;
+		priv.BERDecode(f);
+		assigned.AssignFrom(priv);
+		changed.AssignFrom(priv);
+		Integer t(GlobalRNG(), Integer::Two(), priv.GetModulus()-1);
+		RabinFunction &changedPublic = changed;
+		changedPublic.SetQuadraticResidueModPrime1(priv.GetQuadraticResidueModPrime1() * t.Squared() % priv.GetModulus());
+		bool fail = false;
+		for (unsigned int i=0; i<24; i++)
+		{
+			Integer x(GlobalRNG(), Integer::Zero(), priv.GetModulus()-1);
+			const InvertibleRabinFunction &key = i%3 == 0 ? priv : i%3 == 1 ? assigned : changed;
+			fail = fail || (Integer::Gcd(x, key.GetModulus()) == Integer::One() && key.ApplyFunction(key.CalculateInverse(GlobalRNG(), x)) != x);
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "private key operations on random inputs\n";
 	}
 	{
 		RabinES<OAEP<SHA> >::Decryptor priv(GlobalRNG(), 512);
@@ -520,7 +1043,27 @@ bool ValidateRW()
 	RWSS<PSSR, SHA>::Signer priv(f);
 	RWSS<PSSR, SHA>::Verifier pub(priv);
 
-	return SignatureValidate(priv, pub);
+	bool pass = SignatureValidate(priv, pub);
+	pass = BatchSignatureValidate(priv, pub) && pass;
+	{
+		// see ValidateRabin()
+		InvertibleRWFunction assigned;
+		assigned.AssignFrom(priv.GetKey());
+		bool fail = false;
+		for (unsigned int i=0; i<16; i++)
+		{
+			// RW images are the values that CompleteFunction() produces, so map a random preimage
+			Integer y(GlobalRNG(), Integer::Zero(), assigned.PreimageBound()-1);
+			Integer x = assigned.ApplyFunction(y);
+			const InvertibleRWFunction &key = i%2 ? priv.GetKey() : assigned;
+			fail = fail || (!x.IsZero() && key.ApplyFunction(key.CalculateInverse(GlobalRNG(), x)) != x);
+		}
+		pass = pass && !fail;
+
+		cout << (fail ? "FAILED    " : "passed    ");
+		cout << "private key operations on random inputs\n";
+	}
+	return pass;
 }
 
 bool ValidateECP()
@@ -544,6 +1087,13 @@ bool ValidateECP()
 	spriv.AccessKey().LoadPrecomputation(queue);
 
 	bool pass = SignatureValidate(spriv, spub);
+	pass = BatchSignatureValidate(spriv, spub) && pass;
+	pass = BatchSigningValidate(spriv, spub) && pass;
+	{
+		cout << "Using a per-thread arithmetic workspace..." << endl;
+		ArithmeticWorkspace workspace;
+		pass = SignatureValidate(spriv, spub) && pass;
+	}
 	cpub.AccessKey().Precompute();
 	cpriv.AccessKey().Precompute();
 	pass = CryptoSystemValidate(cpriv, cpub) && pass;
@@ -565,6 +1115,29 @@ bool ValidateECP()
 	{
 		DL_GroupParameters_EC<ECP> params(oid);
 		bool fail = !params.Validate(GlobalRNG(), 2);
+
+		// compare the Jacobian multiplications with the affine ones in AbstractGroup
+		const ECP &ec = params.GetCurve();
+		const ECP::Point &G = params.GetSubgroupGenerator();
+		const Integer &n = params.GetSubgroupOrder();
+		Integer k1(GlobalRNG(), 1, n-1), k2(GlobalRNG(), 1, n-1);
+		ECP::Point P = ec.AbstractGroup<ECP::Point>::ScalarMultiply(G, k1);
+		ECP::Point Q = ec.AbstractGroup<ECP::Point>::ScalarMultiply(G, k2);
+		fail = fail || !(ec.ScalarMultiply(G, k1) == P);
+		fail = fail || !(ec.CascadeScalarMultiply(G, k1, G, k2) == ec.AbstractGroup<ECP::Point>::CascadeScalarMultiply(G, k1, G, k2));
+		fail = fail || !(ec.CascadeScalarMultiply(G, k1, Q, -Integer::One()) == ec.Subtract(P, Q));
+		fail = fail || !ec.CascadeScalarMultiply(G, k1, P, n-1).identity;
+		fail = fail || !ec.ScalarMultiply(G, n).identity;
+
+		// and the interleaved NAFs of several terms, some with explicit window sizes
+		Integer k3(GlobalRNG(), 1, 0xffff);
+		const ECP::Point bases[4] = {G, P, Q, ec.Identity()};
+		const Integer exponents[4] = {k2, n-k1, k3, k1};
+		const unsigned int windowSizes[4] = {2, 0, 7, 3};
+		ECP::Point R = ec.AbstractGroup<ECP::Point>::ScalarMultiply(G, (k2 + (n-k1)*k1 + k3*k2) % n);
+		fail = fail || !(ec.MultiScalarMultiply(bases, exponents, 4, windowSizes) == R);
+		fail = fail || !(ec.AbstractGroup<ECP::Point>::MultiScalarMultiply(bases, exponents, 4, windowSizes) == R);
+
 		cout << (fail ? "FAILED" : "passed") << "    " << dec << params.GetCurve().GetField().MaxElementBitLength() << " bits" << endl;
 		pass = pass && !fail;
 	}
@@ -13,14 +13,37 @@ def main(args):
 
 	seed = args.randomseed
 
+	if args.keycache and not os.path.isdir(args.keycache):
+		os.makedirs(args.keycache)
+
 	for payloadSize in args.payloadsizes:
 		payload = os.urandom(int(payloadSize))
 
 		for size in args.keysizes:
 			for n in range(int(args.trials)):
 				print >> sys.stderr, len(str(payload)), str(size), str(n)
-				p = Popen(['./verifier', str(size), str(seed)], stdin=PIPE, stdout=PIPE, stderr=PIPE)
-				stdout, stderr = p.communicate(str(payload))
+				command = ['./verifier', str(size), str(seed)]
+				if args.keycache:
+					command += ['--key-cache', args.keycache]
+				if args.warmup or args.repetitions:
+					command += ['--warmup', str(args.warmup or 0), '--repetitions', str(args.repetitions or 1)]
+				if args.threads:
+					command += ['--threads', str(args.threads), '--duration', str(args.duration)]
+				if args.adaptive:
+					command += ['--adaptive-precomputation', str(args.adaptive)]
+				if args.phases:
+					command += ['--phases']
+				if args.stream:
+					command += ['--stream']
+					with tempfile.TemporaryFile() as payloadFile:
+						payloadFile.write(payload)
+						payloadFile.flush()
+						payloadFile.seek(0)
+						p = Popen(command, stdin=payloadFile, stdout=PIPE, stderr=PIPE)
+						stdout, stderr = p.communicate()
+				else:
+					p = Popen(command, stdin=PIPE, stdout=PIPE, stderr=PIPE)
+					stdout, stderr = p.communicate(str(payload))
 				for line in stdout.split("\n"):
 					line = line.strip()
 					if len(line) > 0:
@@ -49,6 +72,14 @@ python verifier-runner.py -t 100 -k 112 -r RANDOMSEEDFORTHISTESTTESTTESTEASDASDA
 	parser.add_argument('-k', '--keysizes', nargs='+', required=True, help="Key sizes to test.")
 	parser.add_argument('-r', '--randomseed', required=True, help="Random seed.")
 	parser.add_argument('-p', '--payloadsizes', nargs='+', required=True, help="Payload size for all signatures.")
+	parser.add_argument('-n', '--threads', required=False, help="Measure throughput with this many threads sharing each key.")
+	parser.add_argument('-d', '--duration', default=1, required=False, help="Seconds to run each throughput loop for.")
+	parser.add_argument('-w', '--warmup', required=False, help="Untimed runs of each operation before timing it.")
+	parser.add_argument('-e', '--repetitions', required=False, help="Timed runs of each operation within one process.")
+	parser.add_argument('-S', '--stream', default=False, required=False, action="store_true", help="Stream the payload from a file and time hashing separately.")
+	parser.add_argument('-P', '--phases', default=False, required=False, action="store_true", help="Add hash, encode, key operation and decode times to each row.")
+	parser.add_argument('-a', '--adaptive', required=False, help="Precompute DL public elements after this many uses of a key.")
+	parser.add_argument('-c', '--keycache', required=False, help="Directory in which to keep generated keys between runs.")
 	parser.add_argument('-s', '--sign', default=False, required=False, action="store_true", help="Output signature generation times.")
 	parser.add_argument('-v', '--verify', default=False, required=False, action="store_true", help="Output verification times.")
 
@@ -1,5 +1,5 @@
 // verifier.cpp - written and placed in the public domain by Wei Dai
-// g++ -o verifier verifier.cpp libcryptopp.a
+// g++ -o verifier verifier.cpp libcryptopp.a -lpthread
 
 #include "dll.h"
 #include "pch.h"
@@ -32,6 +32,7 @@
 #include "ida.h"
 #include "base64.h"
 #include "factory.h"
+#include "sha.h"
 
 #include "regtest.cpp"
 
@@ -42,6 +43,18 @@
 #include <ctime>
 #include <cassert>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+
+#if (CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64) && defined(__GNUC__)
+#include <x86intrin.h>
+#elif (CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 USING_NAMESPACE(CryptoPP)
 USING_NAMESPACE(std)
@@ -53,10 +66,47 @@ int securityLevels[NUMBER_OF_SECURITY_LENGTHS] = {80, 112, 128, 192, 256};
 int finiteFieldSizes[NUMBER_OF_SECURITY_LENGTHS] = {1024, 2048, 3072, 7680, 15360};
 int finiteFieldSubgroupSizes[NUMBER_OF_SECURITY_LENGTHS] = {160, 224, 256, 384, 511};
 int factorizationGroupSizes[NUMBER_OF_SECURITY_LENGTHS] = {1024, 2048, 3072, 7680, 15360};
-int ellipticCurveSizes[NUMBER_OF_SECURITY_LENGTHS] = {160, 224, 256, 384, 512};
+int ellipticCurveSizes[NUMBER_OF_SECURITY_LENGTHS] = {160, 224, 256, 384, 521};
+int binaryCurveSizes[NUMBER_OF_SECURITY_LENGTHS] = {163, 233, 283, 409, 571};
+
+// the recommended curves of those sizes, see GetRecommendedParameters() in eccrypto.cpp
+OID (*primeCurves[NUMBER_OF_SECURITY_LENGTHS])() = {ASN1::secp160r1, ASN1::secp224r1, ASN1::secp256r1, ASN1::secp384r1, ASN1::secp521r1};
+OID (*binaryCurves[NUMBER_OF_SECURITY_LENGTHS])() = {ASN1::sect163r2, ASN1::sect233r1, ASN1::sect283r1, ASN1::sect409r1, ASN1::sect571r1};
 
 static OFB_Mode<AES>::Encryption s_globalRNG;
 
+// throughput mode, enabled by --threads and --duration
+static unsigned int s_threads = 0;
+static double s_duration = 0;
+
+// statistical timing, enabled by --warmup and --repetitions
+static unsigned int s_warmup = 0;
+static unsigned int s_repetitions = 1;
+
+// hash stdin in chunks instead of buffering it, enabled by --stream
+static bool s_stream = false;
+static const size_t STREAM_CHUNK_SIZE = 1 << 20;
+
+// per phase timings of signing and verifying, enabled by --phases
+static bool s_phases = false;
+
+// public keys precompute their public element after this many uses, enabled by --adaptive-precomputation
+static unsigned int s_adaptiveThreshold = 0;
+static const size_t ADAPTIVE_PRECOMPUTATION_BUDGET = 64 << 20;
+
+// number of primes in RSA moduli, set by --rsa-primes
+static unsigned int s_rsaPrimes = 2;
+
+// the most primes a modulus of this size may have before its primes become easier to find
+// by elliptic curve factoring than the modulus is to factor by the number field sieve
+static unsigned int MaxRSAPrimes(int modulusBits) {
+	return modulusBits < 2048 ? 2 : modulusBits < 4096 ? 3 : 5;
+}
+
+// key store, enabled by --key-cache
+static string s_keyCacheDirectory;
+static string s_rngSeed;
+
 RandomNumberGenerator & GlobalRNG()
 {
 	return s_globalRNG;
@@ -102,6 +152,19 @@ generateCSVString(string description, string operation, size_t delta) {
 	return csv;
 }
 
+string 
+generateCSVString(string description, string operation, const vector<size_t> &values) {
+	string csv;
+	csv.append(description);
+	csv.append(",");
+	csv.append(operation);
+	for (size_t i = 0; i < values.size(); i++) {
+		csv.append(",");
+		csv.append(to_string(values[i]));
+	}
+	return csv;
+}
+
 class FixedRNG : public RandomNumberGenerator
 {
 public:
@@ -116,6 +179,310 @@ private:
 	BufferedTransformation &m_source;
 };
 
+// time stamp counter, or 0 where it is not available
+inline word64 ReadCycleCounter()
+{
+#if (CRYPTOPP_BOOL_X86 || CRYPTOPP_BOOL_X64) && (defined(__GNUC__) || defined(_MSC_VER))
+	return __rdtsc();
+#else
+	return 0;
+#endif
+}
+
+// returns median, min, mean, p99 and standard deviation of samples
+template <class T>
+vector<size_t> SummarizeSamples(vector<T> samples)
+{
+	sort(samples.begin(), samples.end());
+
+	double sum = 0, sumOfSquares = 0;
+	for (size_t i = 0; i < samples.size(); i++) {
+		sum += (double)samples[i];
+		sumOfSquares += (double)samples[i] * (double)samples[i];
+	}
+	double mean = sum / samples.size();
+	double variance = std::max(0.0, sumOfSquares / samples.size() - mean * mean);
+
+	vector<size_t> summary;
+	summary.push_back((size_t)samples[samples.size() / 2]);
+	summary.push_back((size_t)samples.front());
+	summary.push_back((size_t)(mean + 0.5));
+	summary.push_back((size_t)samples[std::min(samples.size() - 1, (size_t)(0.99 * samples.size()))]);
+	summary.push_back((size_t)(sqrt(variance) + 0.5));
+	return summary;
+}
+
+// nanoseconds and cycles taken by each timed run of an operation, and with
+// --phases the nanoseconds spent in each SignaturePhaseTimer::Phase
+struct Samples
+{
+	vector<size_t> nanoSeconds;
+	vector<word64> cycles;
+	vector<size_t> phaseNanoSeconds[SignaturePhaseTimer::PHASE_COUNT];
+};
+
+void RecordPhases(const SignaturePhaseTimer &timer, Samples &samples)
+{
+	for (int i = 0; i < SignaturePhaseTimer::PHASE_COUNT; i++)
+		samples.phaseNanoSeconds[i].push_back((size_t)(timer.ElapsedTimeAsDouble((SignaturePhaseTimer::Phase)i) * 1e9 + 0.5));
+}
+
+// records the phases of work done with accumulator, which must come from a signature
+// scheme in this library, in timer (or stops recording if timer is NULL)
+void AttachPhaseTimer(PK_MessageAccumulator &accumulator, SignaturePhaseTimer *timer)
+{
+	static_cast<PK_MessageAccumulatorBase &>(accumulator).SetPhaseTimer(timer);
+}
+
+// accumulates elapsed time and cycles over one or more Start()/Stop() intervals
+class Stopwatch
+{
+public:
+	Stopwatch() : m_nanoSeconds(0), m_cycles(0) {}
+
+	void Start() {
+		m_startTime = std::chrono::steady_clock::now();
+		m_startCycles = ReadCycleCounter();
+	}
+	void Stop() {
+		m_cycles += ReadCycleCounter() - m_startCycles;
+		m_nanoSeconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_startTime).count();
+	}
+	void Record(Samples &samples) const {
+		samples.nanoSeconds.push_back(m_nanoSeconds);
+		samples.cycles.push_back(m_cycles);
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_startTime;
+	word64 m_startCycles;
+	size_t m_nanoSeconds;
+	word64 m_cycles;
+};
+
+// A single timed run with no warmup prints "<description>,<name>,<ns>" as before; otherwise
+// the row is "<description>,<name>,<median>,<min>,<mean>,<p99>,<stddev>" in nanoseconds
+// followed by the same five statistics in time stamp counter cycles. If phases were
+// recorded, the median nanoseconds spent hashing, encoding, in the key operation and
+// decoding are appended as four more columns.
+void ReportSamples(const string &description, const string &name, const Samples &samples)
+{
+	vector<size_t> statistics;
+	if (s_repetitions == 1 && s_warmup == 0) {
+		statistics.push_back(samples.nanoSeconds[0]);
+	} else {
+		statistics = SummarizeSamples(samples.nanoSeconds);
+		vector<size_t> cycleStatistics = SummarizeSamples(samples.cycles);
+		statistics.insert(statistics.end(), cycleStatistics.begin(), cycleStatistics.end());
+	}
+
+	for (int i = 0; i < SignaturePhaseTimer::PHASE_COUNT; i++) {
+		if (!samples.phaseNanoSeconds[i].empty())
+			statistics.push_back(SummarizeSamples(samples.phaseNanoSeconds[i])[0]);
+	}
+	cout << generateCSVString(description, name, statistics) << endl;
+}
+
+// Runs operation s_warmup times untimed and then s_repetitions times timed. operation
+// is passed the phase timer to attach to its accumulator, or NULL without --phases.
+template <class OPERATION>
+void TimeOperation(const string &description, const string &name, OPERATION operation)
+{
+	for (unsigned int i = 0; i < s_warmup; i++)
+		operation((SignaturePhaseTimer *)NULL);
+
+	Samples samples;
+	for (unsigned int i = 0; i < s_repetitions; i++) {
+		SignaturePhaseTimer phaseTimer;
+		Stopwatch stopwatch;
+		stopwatch.Start();
+		operation(s_phases ? &phaseTimer : NULL);
+		stopwatch.Stop();
+		stopwatch.Record(samples);
+		if (s_phases)
+			RecordPhases(phaseTimer, samples);
+	}
+
+	ReportSamples(description, name, samples);
+}
+
+// Feeds stdin, which must be a regular file, into accumulator from the start in
+// STREAM_CHUNK_SIZE pieces. Only the Update() calls are timed, not the reads.
+void StreamStdin(PK_MessageAccumulator &accumulator, Stopwatch &hashing)
+{
+	if (fseek(stdin, 0, SEEK_SET) != 0)
+		throw Exception(Exception::IO_ERROR, "verifier: can not rewind stdin");
+
+	SecByteBlock buffer(STREAM_CHUNK_SIZE);
+	size_t length;
+	while ((length = fread(buffer, 1, buffer.size(), stdin)) > 0) {
+		hashing.Start();
+		accumulator.Update(buffer, length);
+		hashing.Stop();
+	}
+
+	if (ferror(stdin))
+		throw Exception(Exception::IO_ERROR, "verifier: error reading stdin");
+}
+
+// With --stream, stdin is hashed straight into the accumulators for every run instead of
+// being buffered, and hashing ("sign-hash", "verify-hash") is reported separately from the
+// private and public key operations ("sign", "verify"). With --phases the "sign" and
+// "verify" rows also carry the phase columns, whose hash column repeats the hash rows.
+bool ProfileStreamedSignature(PK_Signer &priv, PK_Verifier &pub, string description)
+{
+	SecByteBlock signature(priv.MaxSignatureLength());
+	size_t signatureLength = 0;
+	bool fail = false;
+	Samples signHash, sign, verifyHash, verify;
+
+	for (unsigned int i = 0; i < s_warmup + s_repetitions; i++) {
+		Stopwatch signHashing, signing, verifyHashing, verifying;
+		SignaturePhaseTimer signPhases, verifyPhases;
+
+		member_ptr<PK_MessageAccumulator> signAccumulator(priv.NewSignatureAccumulator(GlobalRNG()));
+		AttachPhaseTimer(*signAccumulator, s_phases ? &signPhases : NULL);
+		StreamStdin(*signAccumulator, signHashing);
+		signing.Start();
+		signatureLength = priv.SignAndRestart(GlobalRNG(), *signAccumulator, signature, false);
+		signing.Stop();
+
+		member_ptr<PK_MessageAccumulator> verifyAccumulator(pub.NewVerificationAccumulator());
+		AttachPhaseTimer(*verifyAccumulator, s_phases ? &verifyPhases : NULL);
+		pub.InputSignature(*verifyAccumulator, signature, signatureLength);
+		StreamStdin(*verifyAccumulator, verifyHashing);
+		verifying.Start();
+		fail = !pub.VerifyAndRestart(*verifyAccumulator) || fail;
+		verifying.Stop();
+
+		if (i >= s_warmup) {
+			signHashing.Record(signHash);
+			signing.Record(sign);
+			verifyHashing.Record(verifyHash);
+			verifying.Record(verify);
+			if (s_phases) {
+				RecordPhases(signPhases, sign);
+				RecordPhases(verifyPhases, verify);
+			}
+		}
+	}
+
+	ReportSamples(description, "sign-hash", signHash);
+	ReportSamples(description, "sign", sign);
+	ReportSamples(description, "verify-hash", verifyHash);
+	ReportSamples(description, "verify", verify);
+
+	assert(!fail);
+	return !fail;
+}
+
+// latencies in nanoseconds of each operation run by each worker thread
+typedef vector<vector<size_t> > WorkerLatencies;
+
+// Runs operation in a loop on s_threads threads for s_duration seconds. Every thread gets
+// its own RNG and arithmetic workspace, so the keys and their precomputation are shared.
+template <class OPERATION>
+WorkerLatencies RunWorkers(OPERATION operation, size_t &wallNanoSeconds)
+{
+	WorkerLatencies latencies(s_threads);
+	vector<SecByteBlock> rngKeys(s_threads);
+	for (unsigned int i = 0; i < s_threads; i++) {
+		rngKeys[i].New(16);
+		GlobalRNG().GenerateBlock(rngKeys[i], rngKeys[i].size());
+	}
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::chrono::steady_clock::time_point endTime = startTime + 
+		std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(s_duration));
+
+	vector<thread> workers;
+	for (unsigned int i = 0; i < s_threads; i++) {
+		workers.push_back(thread([&, i]() {
+			ArithmeticWorkspace workspace;
+#ifdef CRYPTOPP_SCRATCH_ARENA
+			ScratchArena arena;
+#endif
+			OFB_Mode<AES>::Encryption rng(rngKeys[i], rngKeys[i].size(), rngKeys[i]);
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			while (now < endTime) {
+				operation(rng);
+				std::chrono::steady_clock::time_point then = std::chrono::steady_clock::now();
+				latencies[i].push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(then - now).count());
+				now = then;
+			}
+		}));
+	}
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	wallNanoSeconds = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	return latencies;
+}
+
+size_t Percentile(const vector<size_t> &sorted, double fraction)
+{
+	if (sorted.empty())
+		return 0;
+	return sorted[std::min(sorted.size() - 1, (size_t)(fraction * sorted.size()))];
+}
+
+// prints "<description>,<operation>-throughput,<threads>,<operations>,<operations per second>"
+// followed by one "<description>,<operation>-latency,<thread>,<operations>,<p50>,<p90>,<p99>,<max>" line per thread
+void ReportThroughput(const string &description, const string &operation, WorkerLatencies &latencies, size_t wallNanoSeconds)
+{
+	size_t total = 0;
+	for (size_t i = 0; i < latencies.size(); i++)
+		total += latencies[i].size();
+
+	vector<size_t> throughput;
+	throughput.push_back(latencies.size());
+	throughput.push_back(total);
+	throughput.push_back(wallNanoSeconds ? (size_t)(total * 1e9 / wallNanoSeconds) : 0);
+	cout << generateCSVString(description, operation + "-throughput", throughput) << endl;
+
+	for (size_t i = 0; i < latencies.size(); i++) {
+		vector<size_t> &sorted = latencies[i];
+		sort(sorted.begin(), sorted.end());
+
+		vector<size_t> percentiles;
+		percentiles.push_back(i);
+		percentiles.push_back(sorted.size());
+		percentiles.push_back(Percentile(sorted, 0.50));
+		percentiles.push_back(Percentile(sorted, 0.90));
+		percentiles.push_back(Percentile(sorted, 0.99));
+		percentiles.push_back(sorted.empty() ? 0 : sorted.back());
+		cout << generateCSVString(description, operation + "-latency", percentiles) << endl;
+	}
+}
+
+bool ProfileSignatureThroughput(PK_Signer &priv, PK_Verifier &pub, const byte *input, 
+	const size_t inputLength, string description)
+{
+	// sign and verify once up front, which also caches the key validation results
+	// so that the workers only ever read the shared key objects
+	SecByteBlock signature(priv.MaxSignatureLength());
+	size_t signatureLength = priv.SignMessage(GlobalRNG(), input, inputLength, signature);
+	bool pass = pub.VerifyMessage(input, inputLength, signature, signatureLength);
+	assert(pass);
+
+	size_t wallNanoSeconds;
+	WorkerLatencies latencies = RunWorkers([&](RandomNumberGenerator &rng) {
+		SecByteBlock workerSignature(priv.MaxSignatureLength());
+		priv.SignMessage(rng, input, inputLength, workerSignature);
+	}, wallNanoSeconds);
+	ReportThroughput(description, "sign", latencies, wallNanoSeconds);
+
+	std::atomic<bool> failed(false);
+	latencies = RunWorkers([&](RandomNumberGenerator &rng) {
+		if (!pub.VerifyMessage(input, inputLength, signature, signatureLength))
+			failed = true;
+	}, wallNanoSeconds);
+	ReportThroughput(description, "verify", latencies, wallNanoSeconds);
+
+	assert(!failed);
+	return pass && !failed;
+}
+
 bool ProfileSignatureValidate(PK_Signer &priv, PK_Verifier &pub, const byte *input, 
 	const size_t inputLength, string description, bool thorough = false)
 {
@@ -124,29 +491,111 @@ bool ProfileSignatureValidate(PK_Signer &priv, PK_Verifier &pub, const byte *inp
 	fail = !pub.GetMaterial().Validate(GlobalRNG(), thorough ? 3 : 2) || !priv.GetMaterial().Validate(GlobalRNG(), thorough ? 3 : 2);
 	assert(pass && !fail);
 
+	if (s_threads > 0)
+		return ProfileSignatureThroughput(priv, pub, input, inputLength, description);
+	if (s_stream)
+		return ProfileStreamedSignature(priv, pub, description);
+
 	SecByteBlock signature(priv.MaxSignatureLength());
+	size_t signatureLength = 0;
+
+	// the same steps as SignMessage() and VerifyMessage(), but with access to the accumulator
+	TimeOperation(description, "sign", [&](SignaturePhaseTimer *phaseTimer) {
+		member_ptr<PK_MessageAccumulator> accumulator(priv.NewSignatureAccumulator(GlobalRNG()));
+		AttachPhaseTimer(*accumulator, phaseTimer);
+		accumulator->Update(input, inputLength);
+		signatureLength = priv.SignAndRestart(GlobalRNG(), *accumulator, signature, false);
+	});
+
+	fail = false;
+	TimeOperation(description, "verify", [&](SignaturePhaseTimer *phaseTimer) {
+		member_ptr<PK_MessageAccumulator> accumulator(pub.NewVerificationAccumulator());
+		AttachPhaseTimer(*accumulator, phaseTimer);
+		pub.InputSignature(*accumulator, signature, signatureLength);
+		accumulator->Update(input, inputLength);
+		if (!pub.VerifyAndRestart(*accumulator))
+			fail = true;
+	});
 
-	std::chrono::steady_clock::time_point signStartTime = std::chrono::steady_clock::now();
-	size_t signatureLength = priv.SignMessage(GlobalRNG(), input, inputLength, signature);
-	std::chrono::steady_clock::time_point signEndTime = std::chrono::steady_clock::now();
-	size_t signNanoSeconds = std::chrono::duration_cast<std::chrono::nanoseconds>(signEndTime - signStartTime).count();
+	assert(pass && !fail);
+	return pass;
+}
 
-	cout << generateCSVString(description, "sign", signNanoSeconds) << endl;
+// Keys are generated from an RNG derived from the seed, scheme and key length, so each key
+// is independent of which other keys were generated or loaded before it in this run.
+void SeedKeyGenerationRNG(OFB_Mode<AES>::Encryption &rng, const string &scheme, const int keyLength)
+{
+	string keyName = scheme + "," + to_string(keyLength) + ",";
+	SHA256 hash;
+	hash.Update((const byte *)keyName.data(), keyName.size());
+	hash.Update((const byte *)s_rngSeed.data(), s_rngSeed.size());
+
+	SecByteBlock digest(hash.DigestSize());
+	hash.Final(digest);
+	rng.SetKeyWithIV(digest, 16, digest + 16);
+}
 
-	std::chrono::steady_clock::time_point verifyStartTime = std::chrono::steady_clock::now();
-	fail = !pub.VerifyMessage(input, inputLength, signature, signatureLength);
-	std::chrono::steady_clock::time_point verifyEndTime = std::chrono::steady_clock::now();
-	size_t verifyNanoSeconds = std::chrono::duration_cast<std::chrono::nanoseconds>(verifyEndTime - verifyStartTime).count();
+// "<directory>/<scheme>-<key length>-<hex seed>.<extension>", or "" if there is no key store
+string KeyCachePath(const string &scheme, const int keyLength, const string &extension)
+{
+	if (s_keyCacheDirectory.empty())
+		return "";
 
-	cout << generateCSVString(description, "verify", verifyNanoSeconds) << endl;
+	string seed;
+	StringSource(s_rngSeed, true, new HexEncoder(new StringSink(seed)));
+	return s_keyCacheDirectory + "/" + scheme + "-" + to_string(keyLength) + "-" + seed + "." + extension;
+}
 
-	assert(pass && !fail);
-	return pass;
+bool FileExists(const string &path)
+{
+	return !path.empty() && ifstream(path.c_str(), ios::binary).good();
+}
+
+// Loads the private key (DER) and, if requested, its precomputation from the key store,
+// generating and storing whatever is missing. Keys are generated with keyLength as their
+// size unless generationParameters, such as the OID of a curve, are given.
+template <class SIGNER>
+void LoadOrGenerateKey(SIGNER &priv, const string &scheme, const int keyLength, bool precompute = false,
+	const NameValuePairs *generationParameters = NULL)
+{
+	string keyPath = KeyCachePath(scheme, keyLength, "der");
+	string precomputationPath = KeyCachePath(scheme, keyLength, "pre");
+
+	if (FileExists(keyPath)) {
+		FileSource keyFile(keyPath.c_str(), true);
+		priv.AccessKey().BERDecode(keyFile);
+	} else {
+		OFB_Mode<AES>::Encryption rng;
+		SeedKeyGenerationRNG(rng, scheme, keyLength);
+		if (generationParameters)
+			priv.AccessKey().GenerateRandom(rng, *generationParameters);
+		else
+			priv.AccessKey().GenerateRandomWithKeySize(rng, keyLength);
+		if (!keyPath.empty()) {
+			FileSink keyFile(keyPath.c_str());
+			priv.GetKey().DEREncode(keyFile);
+		}
+	}
+
+	if (!precompute)
+		return;
+
+	if (FileExists(precomputationPath)) {
+		FileSource precomputationFile(precomputationPath.c_str(), true);
+		priv.AccessMaterial().LoadPrecomputation(precomputationFile);
+	} else {
+		priv.AccessMaterial().Precompute(16);
+		if (!precomputationPath.empty()) {
+			FileSink precomputationFile(precomputationPath.c_str());
+			priv.GetMaterial().SavePrecomputation(precomputationFile);
+		}
+	}
 }
 
 bool ValidateRSA(const byte *input, const size_t inputLength, const int secLevelIndex)
 {
-	string description = generateDetailedDescription("RSA", securityLevels[secLevelIndex], 
+	string scheme = s_rsaPrimes == 2 ? string("RSA") : "RSA-" + to_string(s_rsaPrimes) + "prime";
+	string description = generateDetailedDescription(scheme, securityLevels[secLevelIndex], 
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
 	// FileSource keys("TestData/rsa512a.dat", true, new HexDecoder);
@@ -154,7 +603,10 @@ bool ValidateRSA(const byte *input, const size_t inputLength, const int secLevel
 
 	// Weak::RSASSA_PKCS1v15_MD2_Signer rsaPriv(keys);
 
-	Weak::RSASSA_PKCS1v15_MD2_Signer rsaPriv(GlobalRNG(), factorizationGroupSizes[secLevelIndex]);
+	Weak::RSASSA_PKCS1v15_MD2_Signer rsaPriv;
+	AlgorithmParameters rsaParameters = MakeParameters(Name::ModulusSize(), factorizationGroupSizes[secLevelIndex])
+		(Name::PrimeCount(), (int)s_rsaPrimes);
+	LoadOrGenerateKey(rsaPriv, scheme, factorizationGroupSizes[secLevelIndex], false, &rsaParameters);
 	Weak::RSASSA_PKCS1v15_MD2_Verifier rsaPub(rsaPriv);
 
 	bool pass = ProfileSignatureValidate(rsaPriv, rsaPub, input, inputLength, description);
@@ -168,8 +620,8 @@ bool ValidateNR(const byte *input, const size_t inputLength, const int secLevelI
 	string description = generateDetailedDescription("NR", securityLevels[secLevelIndex], 
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
-	NR<SHA>::Signer privS(GlobalRNG(), finiteFieldSubgroupSizes[secLevelIndex]);
-	privS.AccessKey().Precompute();
+	NR<SHA>::Signer privS;
+	LoadOrGenerateKey(privS, "NR", finiteFieldSubgroupSizes[secLevelIndex], true);
 	NR<SHA>::Verifier pubS(privS);
 
 	bool pass = ProfileSignatureValidate(privS, pubS, input, inputLength, description);
@@ -182,7 +634,8 @@ bool ValidateDSA(const byte *input, const size_t inputLength, const int secLevel
 	string description = generateDetailedDescription("DSA", securityLevels[secLevelIndex], 
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
-	DSA::Signer priv(GlobalRNG(), factorizationGroupSizes[secLevelIndex]);
+	DSA::Signer priv;
+	LoadOrGenerateKey(priv, "DSA", factorizationGroupSizes[secLevelIndex]);
 	DSA::Verifier pub(priv);
 	bool pass = ProfileSignatureValidate(priv, pub, input, inputLength, description);
 	assert(pass);
@@ -195,7 +648,8 @@ bool ValidateLUC(const byte *input, const size_t inputLength, const int secLevel
 	string description = generateDetailedDescription("LUC", securityLevels[secLevelIndex],
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
-	LUCSSA_PKCS1v15_SHA_Signer priv(GlobalRNG(), factorizationGroupSizes[secLevelIndex]);
+	LUCSSA_PKCS1v15_SHA_Signer priv;
+	LoadOrGenerateKey(priv, "LUC", factorizationGroupSizes[secLevelIndex]);
 	LUCSSA_PKCS1v15_SHA_Verifier pub(priv);
 	bool pass = ProfileSignatureValidate(priv, pub, input, inputLength, description);
 	assert(pass);
@@ -208,7 +662,8 @@ bool ValidateLUC_DL(const byte *input, const size_t inputLength, const int secLe
 	string description = generateDetailedDescription("LUC-DL", securityLevels[secLevelIndex], 
 		finiteFieldSizes[secLevelIndex], inputLength);
 
-	LUC_HMP<SHA>::Signer privS(GlobalRNG(), finiteFieldSizes[secLevelIndex]);
+	LUC_HMP<SHA>::Signer privS;
+	LoadOrGenerateKey(privS, "LUC-DL", finiteFieldSizes[secLevelIndex]);
 	LUC_HMP<SHA>::Verifier pubS(privS);
 	bool pass = ProfileSignatureValidate(privS, pubS, input, inputLength, description);
 	assert(pass);
@@ -221,7 +676,8 @@ bool ValidateRabin(const byte *input, const size_t inputLength, const int secLev
 	string description = generateDetailedDescription("Rabin", securityLevels[secLevelIndex], 
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
-	RabinSS<PSSR, SHA>::Signer priv(GlobalRNG(), factorizationGroupSizes[secLevelIndex]);
+	RabinSS<PSSR, SHA>::Signer priv;
+	LoadOrGenerateKey(priv, "Rabin", factorizationGroupSizes[secLevelIndex]);
 	RabinSS<PSSR, SHA>::Verifier pub(priv);
 	bool pass = ProfileSignatureValidate(priv, pub, input, inputLength, description);
 	assert(pass);
@@ -234,7 +690,8 @@ bool ValidateRW(const byte *input, const size_t inputLength, const int secLevelI
 	string description = generateDetailedDescription("RW", securityLevels[secLevelIndex], 
 		factorizationGroupSizes[secLevelIndex], inputLength);
 
-	RWSS<PSSR, SHA>::Signer priv(GlobalRNG(), factorizationGroupSizes[secLevelIndex]);
+	RWSS<PSSR, SHA>::Signer priv;
+	LoadOrGenerateKey(priv, "RW", factorizationGroupSizes[secLevelIndex]);
 	RWSS<PSSR, SHA>::Verifier pub(priv);
 	bool pass = ProfileSignatureValidate(priv, pub, input, inputLength, description);
 	assert(pass);
@@ -242,24 +699,18 @@ bool ValidateRW(const byte *input, const size_t inputLength, const int secLevelI
 	return pass;
 }
 
-bool ValidateECDSA(const byte *input, const size_t inputLength, const int secLevelIndex)
+// ECDSA over the recommended curve of the given kind for the security level, with the
+// base point precomputed
+template <class EC>
+bool ValidateECDSA(const byte *input, const size_t inputLength, const string &scheme, const int curveSize, const OID &curve, const int secLevelIndex)
 {
-	string description = generateDetailedDescription("ECDSA", securityLevels[secLevelIndex], 1, inputLength);
-
-	// from Sample Test Vectors for P1363
-	GF2NT gf2n(191, 9, 0);
-	byte a[]="\x28\x66\x53\x7B\x67\x67\x52\x63\x6A\x68\xF5\x65\x54\xE1\x26\x40\x27\x6B\x64\x9E\xF7\x52\x62\x67";
-	byte b[]="\x2E\x45\xEF\x57\x1F\x00\x78\x6F\x67\xB0\x08\x1B\x94\x95\xA3\xD9\x54\x62\xF5\xDE\x0A\xA1\x85\xEC";
-	EC2N ec(gf2n, PolynomialMod2(a,24), PolynomialMod2(b,24));
-
-	EC2N::Point P;
-	ec.DecodePoint(P, (byte *)"\x04\x36\xB3\xDA\xF8\xA2\x32\x06\xF9\xC4\xF2\x99\xD7\xB2\x1A\x9C\x36\x91\x37\xF2\xC8\x4A\xE1\xAA\x0D"
-		"\x76\x5B\xE7\x34\x33\xB3\xF9\x5E\x33\x29\x32\xE7\x0E\xA2\x45\xCA\x24\x18\xEA\x0E\xF9\x80\x18\xFB", ec.EncodedPointSize());
-	Integer n("40000000000000000000000004a20e90c39067c893bbb9a5H");
-	Integer d("340562e1dda332f9d2aec168249b5696ee39d0ed4d03760fH");
-	EC2N::Point Q(ec.Multiply(d, P));
-	ECDSA<EC2N, SHA>::Signer priv(ec, P, n, d);
-	ECDSA<EC2N, SHA>::Verifier pub(priv);
+	string description = generateDetailedDescription(scheme, securityLevels[secLevelIndex], curveSize, inputLength);
+
+	typename ECDSA<EC, SHA>::Signer priv;
+	AlgorithmParameters curveParameters = MakeParameters(Name::GroupOID(), curve, false);
+	LoadOrGenerateKey(priv, scheme, curveSize, true, &curveParameters);
+	typename ECDSA<EC, SHA>::Verifier pub(priv);
+	pub.AccessKey().AccessGroupParameters().Precompute(16);
 
 	bool pass = ProfileSignatureValidate(priv, pub, input, inputLength, description);
 	assert(pass);
@@ -267,6 +718,15 @@ bool ValidateECDSA(const byte *input, const size_t inputLength, const int secLev
 	return pass;
 }
 
+bool ValidateECDSA(const byte *input, const size_t inputLength, const int secLevelIndex)
+{
+	bool pass = ValidateECDSA<ECP>(input, inputLength, "ECDSA", ellipticCurveSizes[secLevelIndex], 
+		primeCurves[secLevelIndex](), secLevelIndex);
+	pass = ValidateECDSA<EC2N>(input, inputLength, "ECDSA-EC2N", binaryCurveSizes[secLevelIndex], 
+		binaryCurves[secLevelIndex](), secLevelIndex) && pass;
+	return pass;
+}
+
 // bool ValidateESIGN(const byte *input, const size_t inputLength, const int secLevelIndex)
 // {
 // 	string description = generateDetailedDescription("ESIGN", securityLevels[secLevelIndex], 1);
@@ -293,32 +753,90 @@ void ProfileSignatureSchemes(const byte *inputData, const size_t inputLength, co
 }
 
 void showUsage() {
-	cout << "usage: verifier <security-level> <rng-seed>" << endl;
+	cout << "usage: verifier <security-level> <rng-seed> [--threads N --duration S] [--warmup W --repetitions R] [--stream] [--phases] [--adaptive-precomputation N] [--key-cache DIR] [--rsa-primes N]" << endl;
 	cout << "       security-level: the AES security equivalent level" << endl;
 	cout << "       rng-seed:       the seed for the global RNG" << endl;
+	cout << "       --threads:      run sign and verify loops on N threads sharing each key" << endl;
+	cout << "       --duration:     seconds to run each loop for (default 1)" << endl;
+	cout << "       --warmup:       untimed runs of each operation before timing it (default 0)" << endl;
+	cout << "       --repetitions:  timed runs of each operation; with more than one run, or any" << endl;
+	cout << "                       warmup, each row holds median,min,mean,p99,stddev in ns and" << endl;
+	cout << "                       then in cycles (default 1)" << endl;
+	cout << "       --stream:       hash stdin, which must be redirected from a file, in chunks" << endl;
+	cout << "                       on every run instead of buffering it, and time hashing" << endl;
+	cout << "                       (sign-hash, verify-hash rows) apart from the key operations" << endl;
+	cout << "       --phases:       append the median ns spent hashing, encoding, in the key" << endl;
+	cout << "                       operation and decoding to each sign and verify row" << endl;
+	cout << "       --adaptive-precomputation:" << endl;
+	cout << "                       have DL public keys precompute their public element once" << endl;
+	cout << "                       they have been used N times" << endl;
+	cout << "       --key-cache:    existing directory in which to store generated keys and" << endl;
+	cout << "                       precomputation, which later runs with the same seed load" << endl;
+	cout << "       --rsa-primes:   number of primes in the RSA modulus, 2 to 5 (default 2); at" << endl;
+	cout << "                       most 2 below 2048 bits and 3 below 4096 bits" << endl;
 }
 
 int main(int argc, char **argv) {
-	if (argc != 3) {
+	vector<string> positional;
+	for (int i = 1; i < argc; i++) {
+		string arg(argv[i]);
+		if (arg == "--threads" && i + 1 < argc) {
+			s_threads = atoi(argv[++i]);
+		} else if (arg == "--duration" && i + 1 < argc) {
+			s_duration = atof(argv[++i]);
+		} else if (arg == "--warmup" && i + 1 < argc) {
+			s_warmup = atoi(argv[++i]);
+		} else if (arg == "--repetitions" && i + 1 < argc) {
+			s_repetitions = atoi(argv[++i]);
+		} else if (arg == "--stream") {
+			s_stream = true;
+		} else if (arg == "--adaptive-precomputation" && i + 1 < argc) {
+			s_adaptiveThreshold = atoi(argv[++i]);
+		} else if (arg == "--phases") {
+			s_phases = true;
+		} else if (arg == "--key-cache" && i + 1 < argc) {
+			s_keyCacheDirectory = argv[++i];
+		} else if (arg == "--rsa-primes" && i + 1 < argc) {
+			s_rsaPrimes = atoi(argv[++i]);
+		} else {
+			positional.push_back(arg);
+		}
+	}
+
+	if (positional.size() != 2 || (s_duration > 0 && s_threads == 0) || s_duration < 0 || s_repetitions == 0 || (s_stream && s_threads > 0) || (s_phases && s_threads > 0) || s_rsaPrimes < 2 || s_rsaPrimes > 5) {
 		showUsage();
 		return 1;
 	}
+	if (s_threads > 0 && s_duration == 0) {
+		s_duration = 1;
+	}
 
-	int securityLevel = atoi(argv[1]);
-	string rngSeed(argv[2]);
+	int securityLevel = atoi(positional[0].c_str());
+	string rngSeed(positional[1]);
 	size_t rngSeedLength = 16;
 
-	string fullLine;
-	string line;
-	while (getline(cin, line)) {
-		fullLine.append(line);
+	string input;
+	const byte *inputData = NULL;
+	size_t inputLength = 0;
+	if (s_stream) {
+		long length;
+		if (fseek(stdin, 0, SEEK_END) != 0 || (length = ftell(stdin)) < 0) {
+			cerr << "verifier: --stream needs stdin redirected from a file" << endl;
+			return 1;
+		}
+		inputLength = length;
+	} else {
+		// read stdin as is, including any newlines
+		input.assign(istreambuf_iterator<char>(cin), istreambuf_iterator<char>());
+		inputData = (const byte *) input.data();
+		inputLength = input.length();
 	}
-	byte *inputData = (byte *) fullLine.data();
-	int inputLength = fullLine.length();
 
 	RegisterFactories();
+	DL_AdaptivePrecomputation::SetPolicy(s_adaptiveThreshold, ADAPTIVE_PRECOMPUTATION_BUDGET);
 	rngSeed.resize(rngSeedLength);
 	s_globalRNG.SetKeyWithIV((byte *)rngSeed.data(), rngSeedLength, (byte *)rngSeed.data());
+	s_rngSeed = rngSeed;
 
 	int securityIndex = 0;
 	for (int i = 0; i < NUMBER_OF_SECURITY_LENGTHS; i++) {
@@ -327,6 +845,11 @@ int main(int argc, char **argv) {
 			break;
 		}
 	}
+	if (s_rsaPrimes > MaxRSAPrimes(factorizationGroupSizes[securityIndex])) {
+		cerr << "verifier: a " << factorizationGroupSizes[securityIndex] << "-bit RSA modulus may have at most "
+			<< MaxRSAPrimes(factorizationGroupSizes[securityIndex]) << " primes" << endl;
+		return 1;
+	}
 	
 	ProfileSignatureSchemes(inputData, inputLength, securityIndex);
 }